@@ -0,0 +1,185 @@
+#include "Benchmark.h"
+
+#ifdef BENCHMARK
+#include "MultiDisplay.h"
+#include "Comm.h"
+#include "DerivedMetrics.h"
+#include "Filter.h"
+#include "History.h"
+#include "MQTT.h"
+#include "SensorFilter.h"
+#include "Statistics.h"
+
+#include <pico/stdlib.h>
+#include <hardware/clocks.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+namespace weather_station
+{
+namespace
+{
+constexpr int repeats = 7;
+
+// Keeps results alive so the compiler cannot drop the work
+volatile uint32_t sink;
+
+bool first = true;
+
+// Runs f iterations times per repeat, the first repeat warms up caches and is dropped. Reports the median, min and
+// max nanoseconds per call over the others, the median is what to compare between builds.
+template <typename F>
+void bench(std::string_view name, uint32_t iterations, F&& f)
+{
+    std::array<uint32_t, repeats> nsPerOp;
+    for (int r = -1; r < repeats; ++r) {
+        auto start = time_us_64();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            f(i);
+        }
+        auto elapsed = time_us_64() - start;
+        if (r >= 0) {
+            nsPerOp[r] = elapsed * 1000 / iterations;
+        }
+    }
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    std::cout << (first ? "" : ",\n") << "{\"name\":\"" << name << "\",\"iterations\":" << iterations
+              << ",\"ns_per_op\":" << nsPerOp[repeats / 2] << ",\"min\":" << nsPerOp.front()
+              << ",\"max\":" << nsPerOp.back() << "}";
+    first = false;
+}
+
+uint32_t nextRandom(uint32_t& state)
+{
+    state = state * 1664525 + 1013904223;
+    return state >> 8;
+}
+
+// Raw SCD4x words around 800 ppm, 22.5 C and 45 % with noise and a temperature spike every 50 samples
+std::array<uint16_t, 3> scdWords(uint32_t i)
+{
+    uint32_t state = i;
+    auto noise = static_cast<int32_t>(nextRandom(state) % 41) - 20;
+    return {
+        static_cast<uint16_t>(800 + noise), static_cast<uint16_t>(25280 + noise + (i % 50 == 0 ? 3000 : 0)),
+        static_cast<uint16_t>(29491 + noise * 4)
+    };
+}
+
+// A sample from the raw SCD words through the filters and window stats into a history point and the display, once
+// in the float representation the firmware used before and once with Measurement
+void samplePath(MultiDisplay& md)
+{
+    using TemperatureFilter = FilterPipeline<
+        float, filter::Range<float, -10, 60>, filter::Hampel<float, 7, 30, 1>, filter::Ema<float, 50>>;
+    using HumidityFilter =
+        FilterPipeline<float, filter::Range<float, 0, 100>, filter::Hampel<float, 7, 30, 3>, filter::Ema<float, 50>>;
+    TemperatureFilter temperatureFilter;
+    HumidityFilter humidityFilter;
+    RunningStats co2Stats;
+    RunningStats temperatureStats;
+    RunningStats humidityStats;
+    auto toCenti = [](float value) { return static_cast<int32_t>(value * 100 + (value >= 0 ? 0.5f : -0.5f)); };
+    bench("Sample path float", 1000, [&](uint32_t i) {
+        auto words = scdWords(i);
+        float temperature = (((21875 * int32_t(words[1])) >> 13) - 45000) / 1000.0f;
+        float humidity = ((12500 * int32_t(words[2])) >> 13) / 1000.0f;
+        auto filteredTemperature = temperatureFilter(temperature);
+        auto filteredHumidity = humidityFilter(humidity);
+        if (!filteredTemperature || !filteredHumidity) {
+            return;
+        }
+        co2Stats.add(words[0]);
+        temperatureStats.add(*filteredTemperature);
+        humidityStats.add(*filteredHumidity);
+        HistoryPoint point = {words[0], toCenti(*filteredTemperature), toCenti(*filteredHumidity)};
+        md.setNumberF(1, *filteredTemperature, 2);
+        md.setNumberF(2, *filteredHumidity, 2);
+        sink = point[1] + point[2];
+    });
+
+    auto filter = SensorFilter::create(SensorConfig::Kind::Scd4x);
+    WindowStats stats;
+    bench("Sample path fixed", 1000, [&](uint32_t i) {
+        auto words = scdWords(i);
+        Measurement measurement;
+        measurement.CO2 = words[0];
+        measurement.Temperature = ((4375 * int32_t(words[1])) >> 14) - 4500;
+        measurement.Humidity = (625 * int32_t(words[2])) >> 12;
+        measurement.Valid = Measurement::HasTemperature | Measurement::HasHumidity | Measurement::HasCO2;
+        if (!filter->apply(measurement)) {
+            return;
+        }
+        stats.CO2.add(measurement.CO2);
+        stats.Temperature.add(measurement.Temperature);
+        stats.Humidity.add(measurement.Humidity);
+        auto point = History::toPoint(measurement);
+        md.setNumber(1, measurement.Temperature, 2);
+        md.setNumber(2, measurement.Humidity, 2);
+        sink = point[1] + point[2];
+    });
+}
+} // namespace
+
+void runBenchmarks()
+{
+    first = true;
+    std::cout << "{\"clk_sys_hz\":" << clock_get_hz(clk_sys) << ",\"benchmarks\":[\n";
+
+    MultiDisplay md(11, 12, {16, 13, 19, 10}, {8 + 2, 8 + 5, 8 + 6, 2}, {8 + 3, 8 + 7, 4, 6, 7, 8 + 4, 3, 5});
+    bench("MultiDisplay::setNumber", 10000, [&](uint32_t i) { md.setNumber(i & 3, i * 37 % 10000); });
+    bench("MultiDisplay::setNumber hex", 10000, [&](uint32_t i) { md.setNumber(i & 3, i & 0xFFFF, -1, true); });
+    bench("MultiDisplay::setNumberF", 10000, [&](uint32_t i) { md.setNumberF(i & 3, 23.45f + i * 0.01f, 2); });
+    bench("MultiDisplay::setNumber centi", 10000, [&](uint32_t i) { md.setNumber(i & 3, 2345 + i % 1000, 2); });
+    bench("MultiDisplay::setSegment", 10000, [&](uint32_t i) { md.setSegment(i & 3, i & 3, i); });
+    bench("MultiDisplay::nextElement segment", 10000, [&](uint32_t) { md.nextElement(); });
+    md.switchMode();
+    bench("MultiDisplay::nextElement digit", 10000, [&](uint32_t) { md.nextElement(); });
+
+    Receiver receiver;
+    const std::array<uint32_t, 5> weatherInfo = {
+        static_cast<uint32_t>(Message::Type::WeatherInfo), 850, 2300, 4500, 2400
+    };
+    bench("Receiver::feed WeatherInfo", 10000, [&](uint32_t) {
+        for (auto word : weatherInfo) {
+            if (auto msg = receiver.feed(word)) {
+                sink = msg->data[0];
+            }
+        }
+    });
+
+    samplePath(md);
+
+    bench("DerivedMetrics::compute", 1000, [&](uint32_t i) {
+        auto derived = DerivedMetrics::compute(1500 + i % 2000, 2000 + i * 7 % 8000);
+        sink = derived.dewPoint + derived.absoluteHumidity + derived.heatIndex;
+    });
+    // What the same metrics cost in software float with logf and expf
+    bench("Magnus float logf/expf", 1000, [&](uint32_t i) {
+        float temperature = 15.0f + (i % 2000) * 0.01f;
+        float humidity = 20.0f + (i * 7 % 8000) * 0.01f;
+        float gamma = logf(humidity / 100) + 17.62f * temperature / (243.12f + temperature);
+        float dewPoint = 243.12f * gamma / (17.62f - gamma);
+        float absoluteHumidity = 216.7f * 6.112f * expf(gamma) / (273.15f + temperature);
+        sink = static_cast<uint32_t>(dewPoint * 100 + absoluteHumidity * 100);
+    });
+
+    WindowStats stats;
+    for (int i = 0; i < 60; ++i) {
+        stats.CO2.add(800 + i);
+        stats.Temperature.add(2250 + i);
+        stats.Humidity.add(4500 - i * 2);
+    }
+    bench("MQTT::FormatStats", 1000, [&](uint32_t i) {
+        sink = MQTT::FormatStats(stats, 1760000000000000ULL + i).size();
+    });
+
+    std::cout << "\n]}\n";
+}
+} // namespace weather_station
+#endif
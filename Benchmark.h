@@ -0,0 +1,11 @@
+#pragma once
+
+namespace weather_station
+{
+// Microbenchmarks of the paths whose cost depends on the RP2040: display digit and register computation, FIFO message
+// decoding, MQTT payload formatting, and the sample path and derived metrics in fixed point against the software float
+// the M0+ would otherwise use. Built with -DBENCHMARK=1 in place of the normal firmware, prints one JSON document to
+// the USB console per run so results can be diffed between builds. The SDK-free filters, statistics, history, derived
+// metrics and DHT decoder are benchmarked on the host, see tests/HostBench.cpp.
+void runBenchmarks();
+} // namespace weather_station
@@ -2,27 +2,172 @@
 
 #include <pico/stdlib.h>
 #include <pico/binary_info.h>
+#include <pico/util/queue.h>
 
+#include <array>
 #include <iostream>
 
 namespace weather_station
 {
-Button::Button(int pin, std::function<void(void)> f)
+namespace
+{
+struct Event
+{
+    uint8_t pin;
+    Button::Gesture gesture;
+};
+
+std::array<Button*, NUM_BANK0_GPIOS> buttons = {};
+queue_t events;
+bool eventsInitialized = false;
+} // namespace
+
+Button::Button(int pin, Handler handler, bool detectDouble)
     : pin_(pin)
-    , f_(f)
+    , handler_(handler)
+    , detectDouble_(detectDouble)
 {
+    if (!eventsInitialized) {
+        queue_init(&events, sizeof(Event), 16);
+        eventsInitialized = true;
+    }
     gpio_init(pin_);
     gpio_set_dir(pin_, GPIO_IN);
     gpio_pull_up(pin_);
+    pressed_ = !gpio_get(pin_);
+    buttons[pin_] = this;
+    gpio_set_irq_enabled_with_callback(pin_, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, &Button::gpioCallback);
+}
+
+Button::~Button()
+{
+    gpio_set_irq_enabled(pin_, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, false);
+    if (debounceAlarm_) {
+        cancel_alarm(debounceAlarm_);
+    }
+    cancel();
+    buttons[pin_] = nullptr;
 }
+
 void Button::Process()
 {
-    auto status = gpio_get(pin_);
-    if (status != status_) {
-        status_ = status;
-        if (status == 1) {
-            f_();
+    Event event;
+    while (queue_try_remove(&events, &event)) {
+        auto button = buttons[event.pin];
+        if (button && button->handler_) {
+            button->handler_(event.gesture);
         }
     }
 }
-} // namespace weather_station
\ No newline at end of file
+
+bool Button::Pending()
+{
+    return eventsInitialized && !queue_is_empty(&events);
+}
+
+void Button::gpioCallback(unsigned int gpio, uint32_t eventMask)
+{
+    if (gpio < buttons.size() && buttons[gpio]) {
+        buttons[gpio]->onEdge();
+    }
+}
+
+void Button::onEdge()
+{
+    // Every bounce pushes the deadline further, the level is sampled once the line has been quiet for debounceMs
+    if (debounceAlarm_) {
+        cancel_alarm(debounceAlarm_);
+    }
+    debounceAlarm_ = add_alarm_in_ms(debounceMs, &Button::debounceCallback, this, true);
+}
+
+int64_t Button::debounced()
+{
+    debounceAlarm_ = 0;
+    bool pressed = !gpio_get(pin_);
+    if (pressed == pressed_) {
+        return 0;
+    }
+    pressed_ = pressed;
+    if (pressed) {
+        onPress();
+    } else {
+        onRelease();
+    }
+    return 0;
+}
+
+void Button::onPress()
+{
+    if (state_ == State::WaitSecond) {
+        cancel();
+        state_ = State::SecondPress;
+    } else {
+        state_ = State::Pressed;
+    }
+    schedule(longMs);
+}
+
+void Button::onRelease()
+{
+    cancel();
+    switch (state_) {
+        case State::Pressed:
+            if (detectDouble_) {
+                state_ = State::WaitSecond;
+                schedule(doubleMs);
+                return;
+            }
+            emit(Gesture::Press);
+            break;
+        case State::SecondPress:
+            emit(Gesture::DoublePress);
+            break;
+        default:
+            break;
+    }
+    state_ = State::Released;
+}
+
+int64_t Button::gestureTimeout()
+{
+    switch (state_) {
+        case State::Pressed:
+        case State::SecondPress:
+            emit(Gesture::LongPress);
+            state_ = State::Held;
+            return repeatMs * 1000;
+        case State::Held:
+            emit(Gesture::Repeat);
+            return repeatMs * 1000;
+        case State::WaitSecond:
+            emit(Gesture::Press);
+            state_ = State::Released;
+            break;
+        default:
+            break;
+    }
+    gestureAlarm_ = 0;
+    return 0;
+}
+
+void Button::emit(Gesture gesture)
+{
+    Event event{static_cast<uint8_t>(pin_), gesture};
+    // Gestures are dropped if the main loop falls 16 events behind
+    queue_try_add(&events, &event);
+}
+
+void Button::schedule(uint32_t ms)
+{
+    gestureAlarm_ = add_alarm_in_ms(ms, &Button::gestureCallback, this, true);
+}
+
+void Button::cancel()
+{
+    if (gestureAlarm_) {
+        cancel_alarm(gestureAlarm_);
+        gestureAlarm_ = 0;
+    }
+}
+} // namespace weather_station
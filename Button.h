@@ -1,19 +1,64 @@
 #pragma once
 
-#include <functional>
+#include <pico/time.h>
+
+#include <cstdint>
 
 namespace weather_station
 {
+// Active-low push button. Edges are caught by the GPIO interrupt and debounced with a hardware alarm, gestures are
+// recognized in interrupt context and queued. Process() hands them to the handlers from the main loop, so the loop
+// speed only affects when a handler runs, not whether or how a press is detected.
 class Button
 {
 public:
-    explicit Button(int pin, std::function<void(void)> f);
+    enum class Gesture : uint8_t { Press, DoublePress, LongPress, Repeat };
+    using Handler = void (*)(Gesture);
+
+    // Without double press detection a Press is reported right on release instead of after the double press window
+    Button(int pin, Handler handler, bool detectDouble = false);
+    ~Button();
+    Button(const Button&) = delete;
+    Button& operator=(const Button&) = delete;
 
-    void Process();
+    // Dispatches queued gestures of all buttons
+    static void Process();
+    // True if gestures are waiting for Process()
+    static bool Pending();
 
 private:
-    int pin_ = 0;
-    std::function<void(void)> f_;
-    int status_ = 1;
+    enum class State : uint8_t { Released, Pressed, WaitSecond, SecondPress, Held };
+
+    static void gpioCallback(unsigned int gpio, uint32_t eventMask);
+    static int64_t debounceCallback(alarm_id_t id, void* arg)
+    {
+        return static_cast<Button*>(arg)->debounced();
+    }
+    static int64_t gestureCallback(alarm_id_t id, void* arg)
+    {
+        return static_cast<Button*>(arg)->gestureTimeout();
+    }
+
+    void onEdge();
+    int64_t debounced();
+    int64_t gestureTimeout();
+    void onPress();
+    void onRelease();
+    void emit(Gesture gesture);
+    void schedule(uint32_t ms);
+    void cancel();
+
+    static constexpr uint32_t debounceMs = 20;
+    static constexpr uint32_t doubleMs = 300;
+    static constexpr uint32_t longMs = 600;
+    static constexpr uint32_t repeatMs = 200;
+
+    const int pin_;
+    const Handler handler_;
+    const bool detectDouble_;
+    volatile State state_ = State::Released;
+    volatile bool pressed_ = false;
+    volatile alarm_id_t debounceAlarm_ = 0;
+    volatile alarm_id_t gestureAlarm_ = 0;
 };
 } // namespace weather_station
@@ -0,0 +1,96 @@
+#include "Clock.h"
+
+#include <pico/cyw43_arch.h>
+#include <hardware/sync.h>
+
+#include "lwip/apps/sntp.h"
+
+#include <iostream>
+
+#ifndef SNTP_SERVER
+#define SNTP_SERVER "pool.ntp.org"
+#endif
+
+// Hooked up as SNTP_SET_SYSTEM_TIME_US in lwipopts.h, runs in the lwIP context
+extern "C" void clock_sntp_set(uint32_t sec, uint32_t us)
+{
+    weather_station::Clock::sync(static_cast<uint64_t>(sec) * 1000000 + us, time_us_64());
+}
+
+namespace weather_station
+{
+namespace
+{
+// Larger errors are treated as a step (first sync, server change) rather than drift
+constexpr int64_t maxSlewUs = 1000000;
+// Syncs closer together than this say little about drift
+constexpr uint64_t minDriftWindowUs = 60ULL * 1000000;
+constexpr int32_t maxDriftPpb = 500000;
+} // namespace
+
+void Clock::start()
+{
+    cyw43_arch_lwip_begin();
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, SNTP_SERVER);
+    sntp_init();
+    cyw43_arch_lwip_end();
+    std::cout << "SNTP started with " << SNTP_SERVER << "\n";
+}
+
+int64_t Clock::correction(uint64_t monotonicUs)
+{
+    auto elapsed = static_cast<int64_t>(monotonicUs - syncedAt_);
+    return elapsed / 1000 * driftPpb_ / 1000000;
+}
+
+void Clock::sync(uint64_t utcUs, uint64_t monotonicUs)
+{
+    auto state = save_and_disable_interrupts();
+    int64_t error = 0;
+    if (synced_) {
+        error = static_cast<int64_t>(utcUs - (monotonicUs + offset_ + correction(monotonicUs)));
+        auto window = monotonicUs - syncedAt_;
+        if (error > maxSlewUs || error < -maxSlewUs) {
+            driftPpb_ = 0;
+        } else if (window >= minDriftWindowUs) {
+            // What is left over after the current estimate, in ppb of the time since the last sync
+            driftPpb_ += static_cast<int32_t>(error * 1000000 / static_cast<int64_t>(window / 1000));
+            if (driftPpb_ > maxDriftPpb) {
+                driftPpb_ = maxDriftPpb;
+            } else if (driftPpb_ < -maxDriftPpb) {
+                driftPpb_ = -maxDriftPpb;
+            }
+        }
+    }
+    offset_ = static_cast<int64_t>(utcUs - monotonicUs);
+    syncedAt_ = monotonicUs;
+    synced_ = true;
+    restore_interrupts(state);
+    std::cout << "Clock synced, error " << error << " us, drift " << driftPpb_ << " ppb\n";
+}
+
+uint64_t Clock::toUtc(uint64_t monotonicUs)
+{
+    if (!synced_) {
+        return 0;
+    }
+    // sync() runs from an interrupt, don't let it change the offset halfway through
+    auto state = save_and_disable_interrupts();
+    auto utc = monotonicUs + offset_ + correction(monotonicUs);
+    restore_interrupts(state);
+    return utc;
+}
+
+uint64_t Clock::toMonotonic(uint64_t utcUs)
+{
+    if (!synced_) {
+        return 0;
+    }
+    auto state = save_and_disable_interrupts();
+    uint64_t monotonic = utcUs - offset_;
+    monotonic -= correction(monotonic);
+    restore_interrupts(state);
+    return monotonic;
+}
+} // namespace weather_station
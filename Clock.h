@@ -0,0 +1,44 @@
+#pragma once
+
+#include <pico/time.h>
+
+#include <cstdint>
+
+namespace weather_station
+{
+// Maps the monotonic microsecond timer to UTC. SNTP provides the offset, consecutive syncs estimate how far the
+// crystal is off so the mapping stays accurate between them. Measurements keep their monotonic time, which is
+// converted when it is exported, so samples taken before the first sync still get a correct wall-clock time.
+class Clock
+{
+public:
+    // Starts periodic SNTP sync, call once the network is up
+    static void start();
+    // SNTP callback, utcUs was valid at monotonicUs
+    static void sync(uint64_t utcUs, uint64_t monotonicUs);
+
+    static bool synced()
+    {
+        return synced_;
+    }
+    // UTC microseconds since the epoch, 0 until synced
+    static uint64_t toUtc(uint64_t monotonicUs);
+    static uint64_t toMonotonic(uint64_t utcUs);
+    static uint64_t now()
+    {
+        return toUtc(time_us_64());
+    }
+    static int32_t driftPpb()
+    {
+        return driftPpb_;
+    }
+
+private:
+    static int64_t correction(uint64_t monotonicUs);
+
+    static inline volatile bool synced_ = false;
+    static inline uint64_t syncedAt_ = 0;
+    static inline int64_t offset_ = 0;
+    static inline int32_t driftPpb_ = 0;
+};
+} // namespace weather_station
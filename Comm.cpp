@@ -1,7 +1,8 @@
 #include "Comm.h"
+#include "Trace.h"
 
 #include <pico/stdlib.h>
-#include <pico/multicore.h>
+#include <pico/util/queue.h>
 
 #include <iostream>
 #include <cstring>
@@ -13,23 +14,52 @@ namespace
 const std::map<Message::Type, int> messageSize = {
     {Message::Type::WeatherInfo, 4},
     {Message::Type::IncDelay, 0},
-    {Message::Type::DecDelay, 0}
+    {Message::Type::DecDelay, 0},
+    {Message::Type::SetBrightness, 1},
+    {Message::Type::DisplayPower, 1}
 };
+
+// As deep as the SIO FIFO it replaces, so a slow core 1 holds core 0 back the same way
+constexpr unsigned channelDepth = 8;
+queue_t channel;
+}
+
+void initChannel()
+{
+    queue_init(&channel, sizeof(uint32_t), channelDepth);
+}
+
+void send(uint32_t word)
+{
+    Trace::instant(Trace::Point::FifoPush, word);
+    queue_add_blocking(&channel, &word);
+}
+
+bool pending()
+{
+    return !queue_is_empty(&channel);
 }
 
 Message* Receiver::process()
 {
-    if (!multicore_fifo_rvalid()) {
+    uint32_t word;
+    if (!queue_try_remove(&channel, &word)) {
         return nullptr;
     }
+    Trace::Scope scope(Trace::Point::Receive, static_cast<uint32_t>(state_));
+    Trace::instant(Trace::Point::FifoPop, word);
+    return feed(word);
+}
+
+Message* Receiver::feed(uint32_t word)
+{
     switch (state_) {
         case State::Idle: {
-            uint32_t val = multicore_fifo_pop_blocking();
-            Message::Type type = static_cast<Message::Type>(val);
-            //std::cout << "Now receiving " << val << "\n";
+            Message::Type type = static_cast<Message::Type>(word);
+            //std::cout << "Now receiving " << word << "\n";
             message_.type = type;
             if (messageSize.count(type) == 0) {
-                std::cout << "Bad message type: " << val << "\n";
+                std::cout << "Bad message type: " << word << "\n";
                 return nullptr;
             }
             toReceive_ = messageSize.at(type);
@@ -40,7 +70,7 @@ Message* Receiver::process()
             return nullptr;
         }
         case State::Receiving: {
-            message_.data[received_++] = multicore_fifo_pop_blocking();
+            message_.data[received_++] = word;
             //std::cout << "Received " << received_ << " out of " << toReceive_ << "\n";
             if (received_ >= toReceive_) {
                 //std::cout << "Final\n";
@@ -11,15 +11,26 @@ namespace weather_station
 
 struct Message
 {
-    enum class Type : uint32_t { Unknown, WeatherInfo, IncDelay, DecDelay };
+    enum class Type : uint32_t { Unknown, WeatherInfo, IncDelay, DecDelay, SetBrightness, DisplayPower };
     Type type = Type::Unknown;
     std::array<uint32_t, 8> data;
 };
 
+// Words for core 1 go through a queue_t instead of the SIO FIFO. flash_safe_execute() parks core 1 with the multicore
+// lockout, whose FIFO interrupt on core 1 swallows every word that is not its own.
+// Call before core 1 is launched.
+void initChannel();
+// Pushes a word to core 1, blocking while the queue is full
+void send(uint32_t word);
+// A word is waiting for core 1
+bool pending();
+
 class Receiver
 {
 public:
     Message* process();
+    // Decodes one word taken from the queue, returns the message once it is complete
+    Message* feed(uint32_t word);
 
 private:
     enum class State { Idle, Receiving };
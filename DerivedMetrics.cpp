@@ -0,0 +1,131 @@
+#include "DerivedMetrics.h"
+
+#include <array>
+#include <cstdlib>
+
+namespace weather_station
+{
+namespace
+{
+// log2(1 + i/32) and 2^(i/32) in Q16
+constexpr std::array<int32_t, 33> log2Table = {
+    0,     2909,  5732,  8473,  11136, 13727, 16248, 18704, 21098, 23433, 25711,
+    27936, 30109, 32234, 34312, 36346, 38336, 40286, 42196, 44068, 45904, 47705,
+    49472, 51207, 52911, 54584, 56229, 57845, 59434, 60997, 62534, 64047, 65536
+};
+constexpr std::array<int32_t, 33> exp2Table = {
+    65536,  66971,  68438,  69936,  71468,  73032,  74632,  76266,  77936,  79642,  81386,
+    83169,  84990,  86851,  88752,  90696,  92682,  94711,  96785,  98905,  101070, 103283,
+    105545, 107856, 110218, 112631, 115098, 117618, 120194, 122825, 125515, 128263, 131072
+};
+constexpr int32_t log2Of10000 = 870824;
+constexpr int32_t ln2 = 45426;
+constexpr int32_t log2e = 94548;
+
+// Magnus coefficients, b in Q16 and c in centi-degrees
+constexpr int64_t magnusB = (1762LL << 16) / 100;
+constexpr int64_t magnusC = 24312;
+
+// log2(value) in Q16, value > 0
+int32_t log2Q16(uint32_t value)
+{
+    int exponent = 31 - __builtin_clz(value);
+    uint32_t normalized = value << (31 - exponent);
+    uint32_t index = (normalized >> 26) & 31;
+    uint32_t fraction = (normalized >> 10) & 0xFFFF;
+    auto low = log2Table[index];
+    auto high = log2Table[index + 1];
+    return (exponent << 16) + low + static_cast<int32_t>(((high - low) * fraction) >> 16);
+}
+
+// 2^x for x in Q16, result in Q16
+int64_t exp2Q16(int32_t x)
+{
+    int32_t exponent = x >> 16;
+    uint32_t fraction = x & 0xFFFF;
+    uint32_t index = fraction >> 11;
+    uint32_t rest = fraction & 0x7FF;
+    auto low = exp2Table[index];
+    auto high = exp2Table[index + 1];
+    int64_t mantissa = low + (((high - low) * rest) >> 11);
+    return exponent >= 0 ? mantissa << exponent : mantissa >> -exponent;
+}
+
+// ln(RH) + b T / (c + T) in Q16, the exponent of the Magnus formula for the actual vapour pressure
+int32_t magnusGamma(int32_t temperature, int32_t humidity)
+{
+    humidity = humidity < 1 ? 1 : (humidity > 10000 ? 10000 : humidity);
+    int32_t lnHumidity = static_cast<int32_t>((static_cast<int64_t>(log2Q16(humidity) - log2Of10000) * ln2) >> 16);
+    return lnHumidity + static_cast<int32_t>(magnusB * temperature / (magnusC + temperature));
+}
+
+uint32_t isqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    for (uint32_t bit = 1u << 30; bit != 0; bit >>= 2) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+    }
+    return root;
+}
+} // namespace
+
+DerivedMetrics DerivedMetrics::compute(int32_t temperature, int32_t humidity)
+{
+    return {
+        dewPointOf(temperature, humidity), absoluteHumidityOf(temperature, humidity),
+        heatIndexOf(temperature, humidity)
+    };
+}
+
+int32_t DerivedMetrics::dewPointOf(int32_t temperature, int32_t humidity)
+{
+    int64_t gamma = magnusGamma(temperature, humidity);
+    return static_cast<int32_t>(magnusC * gamma / (magnusB - gamma));
+}
+
+int32_t DerivedMetrics::absoluteHumidityOf(int32_t temperature, int32_t humidity)
+{
+    // 216.7 g K / m3 hPa for water vapour times the 6.112 hPa of the Magnus formula, times 10000 for the centi-units
+    // of the result and the temperature
+    constexpr int64_t scale = 13244704;
+    int64_t gamma = magnusGamma(temperature, humidity);
+    auto vapour = exp2Q16(static_cast<int32_t>((gamma * log2e) >> 16));
+    return static_cast<int32_t>(scale * vapour / ((27315 + temperature) * 65536LL));
+}
+
+int32_t DerivedMetrics::heatIndexOf(int32_t temperature, int32_t humidity)
+{
+    // The NWS formulas are in Fahrenheit. t is the temperature in milli-F, exact for centi-C, so the branches are not
+    // decided on a rounded value near a boundary and the steep Rothfusz regression does not amplify a rounding error.
+    // r is in centi-percent, index and the products below in centi-units.
+    int64_t t = 18 * temperature + 32000;
+    int64_t r = humidity;
+    int64_t index = (t + 61000 + (t - 68000) * 12 / 10 + r * 94 / 100) / 20;
+    // (Steadman + t) / 2 >= 80 F, multiplied out to 4.2 t + 0.094 r >= 340.6
+    if (210 * t + 47 * r >= 17030000) {
+        // Rothfusz regression, coefficients scaled by 1e8
+        int64_t tr = t * r / 1000;
+        int64_t t2 = t * t / 10000;
+        int64_t r2 = r * r / 100;
+        int64_t t2r = t2 * r / 100;
+        int64_t tr2 = tr * r / 100;
+        int64_t t2r2 = t2r * r / 100;
+        int64_t sum = -423790000000LL + 204901523LL * t / 10 + 1014333127LL * r - 22475541LL * tr - 683783LL * t2 -
+                      5481717LL * r2 + 122874LL * t2r + 85282LL * tr2 - 199LL * t2r2;
+        index = (sum + 50000000) / 100000000;
+        if (r < 1300 && t > 80000 && t < 112000) {
+            auto root = isqrt(static_cast<uint32_t>((17000 - std::abs(t - 95000)) * 1000000 / 17000));
+            index -= (1300 - r) * root / 4000;
+        } else if (r > 8500 && t > 80000 && t < 87000) {
+            index += (r - 8500) * (87000 - t) / 50000;
+        }
+    }
+    int64_t celsius = (index - 3200) * 5;
+    return static_cast<int32_t>((celsius + (celsius < 0 ? -4 : 4)) / 9);
+}
+} // namespace weather_station
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+namespace weather_station
+{
+// Dew point, absolute humidity and heat index in integer arithmetic, the M0+ has no FPU and logf/expf in software
+// cost thousands of cycles each. All values are in centi-units: temperatures in 0.01 C, relative humidity in 0.01 %,
+// absolute humidity in 0.01 g/m3.
+//
+// Dew point and absolute humidity use the Magnus formula (b = 17.62, c = 243.12 C) with ln and exp built from a
+// log2/exp2 table with linear interpolation in Q16. The heat index is the NWS one: Steadman's approximation, the
+// Rothfusz regression above 80 F and its two adjustments. Against the same formulas in double precision the error
+// stays below 0.02 C and 0.03 g/m3 for -20..50 C and 5..100 %, tests/DerivedMetricsTest.cpp checks it on the host.
+struct DerivedMetrics
+{
+    int32_t dewPoint = 0;
+    int32_t absoluteHumidity = 0;
+    int32_t heatIndex = 0;
+
+    static DerivedMetrics compute(int32_t temperature, int32_t humidity);
+
+    static int32_t dewPointOf(int32_t temperature, int32_t humidity);
+    static int32_t absoluteHumidityOf(int32_t temperature, int32_t humidity);
+    static int32_t heatIndexOf(int32_t temperature, int32_t humidity);
+};
+} // namespace weather_station
@@ -0,0 +1,66 @@
+#include "DhtDecoder.h"
+
+namespace weather_station
+{
+DhtDecoder::Result DhtDecoder::decode(const Trace& trace, std::array<uint8_t, 5>& data)
+{
+    data = {};
+    const auto& e = trace.edges;
+    if (trace.count < 3) {
+        return Result::NoResponse;
+    }
+    auto responseLow = e[1] - e[0];
+    auto responseHigh = e[2] - e[1];
+    if (responseLow < minResponse || responseLow > maxResponse || responseHigh < minResponse ||
+        responseHigh > maxResponse) {
+        return Result::BadResponse;
+    }
+    if (trace.count < frameEdges) {
+        return Result::Truncated;
+    }
+
+    // Bit k is low from edge 2 + 2k to 3 + 2k and high until 4 + 2k
+    uint32_t lowSum = 0;
+    for (size_t bit = 0; bit < 40; ++bit) {
+        auto low = e[3 + 2 * bit] - e[2 + 2 * bit];
+        auto high = e[4 + 2 * bit] - e[3 + 2 * bit];
+        if (low < minLow || low > maxLow || high < minHigh || high > maxHigh) {
+            return Result::BadTiming;
+        }
+        lowSum += low;
+    }
+    auto meanLow = lowSum / 40;
+    for (size_t bit = 0; bit < 40; ++bit) {
+        auto high = e[4 + 2 * bit] - e[3 + 2 * bit];
+        data[bit / 8] <<= 1;
+        if (high > meanLow) {
+            data[bit / 8] |= 1;
+        }
+    }
+
+    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+        return Result::Checksum;
+    }
+    return Result::Ok;
+}
+
+const char* DhtDecoder::name(Result result)
+{
+    switch (result) {
+        case Result::Ok:
+            return "ok";
+        case Result::NoResponse:
+            return "no response";
+        case Result::BadResponse:
+            return "bad response";
+        case Result::Truncated:
+            return "truncated";
+        case Result::BadTiming:
+            return "bad timing";
+        case Result::Checksum:
+            return "checksum";
+        default:
+            return "?";
+    }
+}
+} // namespace weather_station
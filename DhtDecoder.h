@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace weather_station
+{
+// Decodes a DHT11/DHT22 frame from the times of the level changes on the data line, so decoding does not depend on
+// how the edges were sampled and failed frames can be replayed. Frame after the host releases the line: the sensor
+// answers with ~80 us low and ~80 us high, then sends 40 bits as ~50 us low followed by ~27 us (0) or ~70 us (1)
+// high, and ends with one more low pulse. Bits are told apart by comparing each high pulse with the mean low pulse
+// of the frame, which holds up better against a single stretched pulse than comparing with the neighbouring one.
+class DhtDecoder
+{
+public:
+    enum class Result : uint8_t { Ok, NoResponse, BadResponse, Truncated, BadTiming, Checksum, Count };
+
+    // Response falling and rising edge, two edges per bit and the falling edge ending the last bit
+    static constexpr size_t frameEdges = 2 + 2 * 40 + 1;
+
+    struct Trace
+    {
+        // Time in us of each level change, starting with the sensor pulling the line low
+        std::array<uint32_t, frameEdges + 1> edges;
+        uint8_t count = 0;
+    };
+
+    static Result decode(const Trace& trace, std::array<uint8_t, 5>& data);
+    static const char* name(Result result);
+
+private:
+    static constexpr uint32_t minResponse = 40;
+    static constexpr uint32_t maxResponse = 120;
+    static constexpr uint32_t minLow = 20;
+    static constexpr uint32_t maxLow = 100;
+    static constexpr uint32_t minHigh = 8;
+    static constexpr uint32_t maxHigh = 100;
+};
+} // namespace weather_station
@@ -0,0 +1,96 @@
+#include "DhtLane.h"
+#include "dht.pio.h"
+
+#include <pico/stdlib.h>
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+
+namespace weather_station
+{
+namespace
+{
+int programOffset = -1;
+
+float clockDivider()
+{
+    // One loop iteration of the program takes two cycles
+    return clock_get_hz(clk_sys) / 2e6f;
+}
+} // namespace
+
+DhtLane::DhtLane(uint8_t pin)
+    : pio_(pio0)
+    , pin_(pin)
+{
+    if (programOffset < 0) {
+        programOffset = pio_add_program(pio_, &dht_program);
+    }
+    sm_ = pio_claim_unused_sm(pio_, true);
+    dma_ = dma_claim_unused_channel(true);
+    dht_program_init(pio_, sm_, programOffset, pin_, clockDivider());
+}
+
+void DhtLane::start(uint32_t startUs)
+{
+    auto config = dma_channel_get_default_config(dma_);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_dreq(&config, pio_get_dreq(pio_, sm_, false));
+    dma_channel_configure(dma_, &config, pulses_.data(), &pio_->rxf[sm_], pulses_.size(), true);
+
+    pio_interrupt_clear(pio_, sm_);
+    pio_sm_put(pio_, sm_, startUs);
+    pio_sm_put(pio_, sm_, pulseTimeoutUs);
+    startUs_ = startUs;
+    startedAt_ = time_us_32();
+    running_ = true;
+}
+
+bool DhtLane::poll(DhtDecoder::Trace& trace)
+{
+    if (!running_) {
+        return false;
+    }
+    // The flag is raised after the last push, wait for the DMA to drain the FIFO as well
+    bool ended = pio_interrupt_get(pio_, sm_) && pio_sm_is_rx_fifo_empty(pio_, sm_);
+    if (!ended && time_us_32() - startedAt_ < startUs_ + frameTimeoutUs) {
+        return false;
+    }
+    running_ = false;
+    size_t words = pulses_.size() - dma_channel_hw_addr(dma_)->transfer_count;
+    if (!ended) {
+        reset();
+    }
+    dma_channel_abort(dma_);
+
+    // No word at all if the sensor never answered
+    trace.count = 0;
+    if (words == 0) {
+        return true;
+    }
+    uint32_t t = 0;
+    trace.edges[trace.count++] = t;
+    for (size_t i = 1; i < words && trace.count < trace.edges.size(); ++i) {
+        t += pulseTimeoutUs - pulses_[i];
+        trace.edges[trace.count++] = t;
+    }
+    return true;
+}
+
+void DhtLane::reset()
+{
+    pio_sm_set_enabled(pio_, sm_, false);
+    pio_sm_clear_fifos(pio_, sm_);
+    pio_sm_restart(pio_, sm_);
+    pio_sm_exec(pio_, sm_, pio_encode_jmp(programOffset));
+    pio_sm_set_consecutive_pindirs(pio_, sm_, pin_, 1, false);
+    pio_interrupt_clear(pio_, sm_);
+    pio_sm_set_enabled(pio_, sm_, true);
+}
+
+void DhtLane::clockChanged()
+{
+    pio_sm_set_clkdiv(pio_, sm_, clockDivider());
+}
+} // namespace weather_station
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "DhtDecoder.h"
+
+#include <hardware/pio.h>
+
+#include <array>
+#include <cstdint>
+
+namespace weather_station
+{
+// One DHT data line timed by a PIO state machine (see dht.pio) with a DMA channel collecting the pulse lengths, so
+// the frame comes in without the CPU polling the pin and the DHTs of a station are read at the same time. All lanes
+// share the program on pio0, which limits a station to four of them.
+class DhtLane
+{
+public:
+    explicit DhtLane(uint8_t pin);
+    DhtLane(const DhtLane&) = delete;
+    DhtLane& operator=(const DhtLane&) = delete;
+
+    // Pulls the line low for startUs and times the answer in the background
+    void start(uint32_t startUs);
+    // True once the frame has ended or timed out, trace then holds its edges in us relative to the sensor answering
+    bool poll(DhtDecoder::Trace& trace);
+    // The state machine divider has to follow clk_sys changes
+    void clockChanged();
+
+private:
+    void reset();
+
+    // A level lasting longer ends the frame, the longest pulse of a frame is ~80 us
+    static constexpr uint32_t pulseTimeoutUs = 200;
+    // Bounds the whole frame in case the state machine stalls on a glitching line
+    static constexpr uint32_t frameTimeoutUs = 10000;
+
+    PIO pio_;
+    uint sm_;
+    int dma_;
+    uint8_t pin_;
+    bool running_ = false;
+    uint32_t startedAt_ = 0;
+    uint32_t startUs_ = 0;
+    // The release-to-answer time and the timeout minus the length of every pulse after it
+    std::array<uint32_t, DhtDecoder::frameEdges + 1> pulses_;
+};
+} // namespace weather_station
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+namespace weather_station
+{
+// Cost of getting samples off the device, to compare the export paths against each other
+struct ExportStats
+{
+    // IPv4 + TCP/UDP + 802.11 MAC/LLC headers, roughly what a frame costs on air besides its payload
+    static constexpr uint32_t tcpFrameOverhead = 20 + 20 + 36;
+    static constexpr uint32_t udpFrameOverhead = 20 + 8 + 36;
+
+    uint32_t samples = 0;
+    uint32_t frames = 0;
+    uint32_t airBytes = 0;
+    uint64_t cpuUs = 0;
+
+    void print(std::string_view name) const
+    {
+        if (samples == 0) {
+            return;
+        }
+        std::cout << name << ": " << samples << " samples, " << cpuUs / samples << " us CPU/sample, "
+                  << airBytes / samples << " bytes/sample in " << frames << " frames\n";
+    }
+
+    // Two export paths of the same samples in one line, e.g. "MQTT vs UDP: 60 vs 60 samples, ..."
+    static void compare(std::string_view nameA, const ExportStats& a, std::string_view nameB, const ExportStats& b)
+    {
+        auto perSample = [](uint64_t total, uint32_t samples) { return samples == 0 ? 0 : total / samples; };
+        std::cout << nameA << " vs " << nameB << ": " << a.samples << " vs " << b.samples << " samples, "
+                  << perSample(a.cpuUs, a.samples) << " vs " << perSample(b.cpuUs, b.samples) << " us CPU/sample, "
+                  << perSample(a.airBytes, a.samples) << " vs " << perSample(b.airBytes, b.samples)
+                  << " bytes/sample, " << a.frames << " vs " << b.frames << " frames\n";
+    }
+};
+} // namespace weather_station
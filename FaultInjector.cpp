@@ -0,0 +1,155 @@
+#include "FaultInjector.h"
+
+#ifdef FAULT_INJECTION
+#include "MQTT.h"
+#include "Network.h"
+#include "Statistics.h"
+
+#include <pico/stdlib.h>
+#include <hardware/sync.h>
+
+#include <array>
+#include <atomic>
+#include <iostream>
+
+namespace weather_station
+{
+namespace
+{
+struct Scenario
+{
+    const char* name;
+    FaultInjector::Fault fault;
+    // Per call for hooked faults, per second for link drops and broker resets
+    uint32_t perMille;
+};
+
+constexpr Scenario scenarios[] = {
+    {"baseline", FaultInjector::Fault::None, 0},
+    {"i2c errors", FaultInjector::Fault::I2cError, 200},
+    {"dht glitches", FaultInjector::Fault::DhtGlitch, 300},
+    {"link drops", FaultInjector::Fault::LinkDrop, 5},
+    {"dns failures", FaultInjector::Fault::DnsFailure, 500},
+    {"broker resets", FaultInjector::Fault::BrokerReset, 10},
+    {"pbuf exhaustion", FaultInjector::Fault::PbufExhaustion, 300},
+    {"slow fifo consumer", FaultInjector::Fault::SlowFifo, 50},
+};
+constexpr size_t scenarioCount = std::size(scenarios);
+constexpr uint64_t activeMs = 300000;
+
+struct Result
+{
+    uint32_t due = 0;
+    uint32_t delivered = 0;
+    // Per core, each only written by its own core since the M0+ has no atomic read-modify-write
+    std::array<std::atomic<uint32_t>, 2> injected = {};
+    RunningStats recoveryMs;
+    RunningStats loopUs;
+};
+
+std::array<Result, scenarioCount> results;
+// Switched by process() on core 0, read by fail() on both cores
+std::atomic<size_t> current = 0;
+std::atomic<bool> active = false;
+bool recovering = false;
+uint64_t phaseStart = 0;
+uint64_t lastTick = 0;
+std::array<uint32_t, 2> seeds = {0x1234567, 0x89ABCDE};
+
+uint32_t roll()
+{
+    // One generator per core, no lock needed
+    auto& seed = seeds[get_core_num()];
+    seed = seed * 1664525 + 1013904223;
+    return (seed >> 8) % 1000;
+}
+} // namespace
+
+bool FaultInjector::fail(Fault fault)
+{
+    // Counted for the scenario that made the decision, even if core 0 moves on in between
+    size_t index = current;
+    const auto& scenario = scenarios[index];
+    if (!active || scenario.fault != fault || roll() >= scenario.perMille) {
+        return false;
+    }
+    auto& injected = results[index].injected[get_core_num()];
+    injected.store(injected.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+void FaultInjector::process(uint64_t now, MQTT& mqtt)
+{
+    if (phaseStart == 0) {
+        phaseStart = now;
+        active = true;
+        std::cout << "Fault injection: " << scenarios[current].name << "\n";
+    }
+    if (now - phaseStart >= activeMs) {
+        phaseStart = now;
+        if (active) {
+            active = false;
+            recovering = true;
+            std::cout << "Fault injection: " << scenarios[current].name << " stopped\n";
+        } else {
+            recovering = false;
+            current = (current + 1) % scenarioCount;
+            if (current == 0) {
+                printReport();
+            }
+            active = true;
+            std::cout << "Fault injection: " << scenarios[current].name << "\n";
+        }
+    }
+
+    if (!active || now - lastTick < 1000) {
+        return;
+    }
+    lastTick = now;
+    auto fault = scenarios[current].fault;
+    if (fault == Fault::LinkDrop && fail(fault)) {
+        std::cout << "Fault injection: dropping the WiFi link\n";
+        Network::leave();
+    } else if ((fault == Fault::BrokerReset || fault == Fault::DnsFailure) && fail(fault)) {
+        // A DNS failure only shows once the client has to resolve the broker again
+        std::cout << "Fault injection: resetting the broker connection\n";
+        mqtt.DropConnection(fault == Fault::DnsFailure);
+    }
+}
+
+void FaultInjector::loop(uint32_t us)
+{
+    if (active) {
+        results[current].loopUs.add(us);
+    }
+}
+
+void FaultInjector::reportDue()
+{
+    ++results[current].due;
+}
+
+void FaultInjector::delivered(uint32_t reports)
+{
+    auto& result = results[current];
+    result.delivered += reports;
+    if (recovering) {
+        result.recoveryMs.add((time_us_64() / 1000) - phaseStart);
+        recovering = false;
+    }
+}
+
+void FaultInjector::printReport()
+{
+    std::cout << "Fault injection report (" << activeMs / 1000 << " s active, " << activeMs / 1000
+              << " s recovery per scenario):\n";
+    for (size_t i = 0; i < scenarioCount; ++i) {
+        const auto& r = results[i];
+        std::cout << "  " << scenarios[i].name << ": " << r.injected[0] + r.injected[1] << " injected, "
+                  << r.delivered << "/" << r.due << " reports delivered, recovery avg " << r.recoveryMs.mean()
+                  << " ms max " << r.recoveryMs.max() << " ms, loop avg " << r.loopUs.mean() << " us max "
+                  << r.loopUs.max() << " us\n";
+    }
+}
+} // namespace weather_station
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+namespace weather_station
+{
+class MQTT;
+
+// Resilience testing with -DFAULT_INJECTION=1. Scenarios run one after another, each with its fault active for
+// activeS seconds followed by a fault-free recovery window of the same length. Per-call faults (I2C errors, DHT line
+// glitches, DNS failures, pbuf exhaustion, a slow FIFO consumer) are rolled at their hook through fail(), link drops
+// and broker resets are triggered from process() with a per-second probability. For every scenario the report gives
+// the share of due reports that reached the broker, how long after the fault stopped the next one got through, and
+// the main loop latency while it was active. Without the flag fail() is constant false and the rest compiles away.
+class FaultInjector
+{
+public:
+    enum class Fault : uint8_t {
+        None,
+        I2cError,
+        DhtGlitch,
+        LinkDrop,
+        DnsFailure,
+        BrokerReset,
+        PbufExhaustion,
+        SlowFifo,
+        Count
+    };
+
+#ifdef FAULT_INJECTION
+    // True if the active scenario injects fault at this call, safe to call from either core
+    static bool fail(Fault fault);
+    static void process(uint64_t now, MQTT& mqtt);
+    // Main loop iteration time
+    static void loop(uint32_t us);
+    static void reportDue();
+    static void delivered(uint32_t reports);
+    static void printReport();
+#else
+    static constexpr bool fail(Fault)
+    {
+        return false;
+    }
+    static void process(uint64_t, MQTT&)
+    {
+    }
+    static void loop(uint32_t)
+    {
+    }
+    static void reportDue()
+    {
+    }
+    static void delivered(uint32_t)
+    {
+    }
+    static void printReport()
+    {
+    }
+#endif
+};
+} // namespace weather_station
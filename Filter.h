@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+
+namespace weather_station
+{
+// Allocation-free filter stages for sensor samples, chained at compile time with FilterPipeline. A stage takes a
+// sample and returns the value to pass on, or nothing if it rejects the sample. Thresholds are template parameters in
+// the units of the metric, window sizes are fixed, so a pipeline is a handful of words per metric.
+namespace filter
+{
+// Drops samples outside [Min, Max], e.g. the zero CO2 readings an SCD4x returns while it settles
+template <typename T, int Min, int Max>
+class Range
+{
+public:
+    static constexpr const char* name = "range";
+
+    std::optional<T> operator()(T value)
+    {
+        if (value < Min || value > Max) {
+            return std::nullopt;
+        }
+        return value;
+    }
+};
+
+// The last N samples, median and median absolute deviation are taken from a partially sorted copy
+template <typename T, size_t N>
+class Window
+{
+public:
+    void add(T value)
+    {
+        values_[next_] = value;
+        next_ = (next_ + 1) % N;
+        if (size_ < N) {
+            ++size_;
+        }
+    }
+    size_t size() const
+    {
+        return size_;
+    }
+    T median() const
+    {
+        auto sorted = values_;
+        return middle(sorted);
+    }
+    T deviation(T center) const
+    {
+        std::array<T, N> deviations = {};
+        for (size_t i = 0; i < size_; ++i) {
+            deviations[i] = distance(values_[i], center);
+        }
+        return middle(deviations);
+    }
+
+    static T distance(T a, T b)
+    {
+        return a > b ? a - b : b - a;
+    }
+
+private:
+    // The middle of the first size_ values, only partially ordered since nothing else is needed
+    T middle(std::array<T, N>& values) const
+    {
+        if (size_ == 0) {
+            return T();
+        }
+        auto end = values.begin() + std::min(size_, N);
+        auto mid = values.begin() + size_ / 2;
+        std::nth_element(values.begin(), mid, end);
+        return *mid;
+    }
+
+    std::array<T, N> values_ = {};
+    size_t next_ = 0;
+    size_t size_ = 0;
+};
+
+// Median of the last N samples, removes single-sample spikes at the cost of N/2 samples of delay
+template <typename T, size_t N>
+class Median
+{
+    static_assert(N % 2 == 1, "an odd window has a middle sample");
+
+public:
+    static constexpr const char* name = "median";
+
+    std::optional<T> operator()(T value)
+    {
+        window_.add(value);
+        return window_.median();
+    }
+
+private:
+    Window<T, N> window_;
+};
+
+// Hampel identifier: rejects a sample further than K/10 scaled median absolute deviations from the median of the N
+// samples before it. Rejected samples still enter the window, so a real step passes once it fills half of it. Floor
+// keeps a flat signal (deviation 0) from rejecting the smallest change.
+template <typename T, size_t N, int KTenths, int Floor>
+class Hampel
+{
+public:
+    static constexpr const char* name = "hampel";
+
+    std::optional<T> operator()(T value)
+    {
+        bool outlier = false;
+        if (window_.size() == N) {
+            auto median = window_.median();
+            // 1.4826 times the deviation estimates the standard deviation of normally distributed samples
+            constexpr int scale = KTenths * 14826 / 1000;
+            T threshold = std::max<T>(window_.deviation(median) * scale / 100, Floor);
+            outlier = Window<T, N>::distance(value, median) > threshold;
+        }
+        window_.add(value);
+        if (outlier) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+private:
+    Window<T, N> window_;
+};
+
+// Exponential moving average, each sample moves the output by AlphaPercent of the difference
+template <typename T, int AlphaPercent>
+class Ema
+{
+public:
+    static constexpr const char* name = "ema";
+
+    std::optional<T> operator()(T value)
+    {
+        if (!state_) {
+            state_ = value;
+        } else {
+            *state_ += (value - *state_) * AlphaPercent / 100;
+        }
+        return state_;
+    }
+
+private:
+    std::optional<T> state_;
+};
+
+// Limits the change between consecutive outputs to MaxStep, a jump is followed over several samples instead of
+// passed on at once
+template <typename T, int MaxStep>
+class RateLimit
+{
+public:
+    static constexpr const char* name = "rate";
+
+    std::optional<T> operator()(T value)
+    {
+        if (last_) {
+            value = std::clamp<T>(value, *last_ - MaxStep, *last_ + MaxStep);
+        }
+        last_ = value;
+        return value;
+    }
+
+private:
+    std::optional<T> last_;
+};
+} // namespace filter
+
+// Runs a sample through Stages in order and counts, per stage, the samples it rejected
+template <typename T, typename... Stages>
+class FilterPipeline
+{
+public:
+    static constexpr size_t stageCount = sizeof...(Stages);
+
+    std::optional<T> operator()(T value)
+    {
+        return apply<0>(value);
+    }
+
+    uint32_t rejected(size_t stage) const
+    {
+        return rejected_[stage];
+    }
+    static const char* stageName(size_t stage)
+    {
+        static constexpr std::array<const char*, stageCount> names = {Stages::name...};
+        return names[stage];
+    }
+
+private:
+    template <size_t I>
+    std::optional<T> apply(T value)
+    {
+        if constexpr (I == stageCount) {
+            return value;
+        } else {
+            auto out = std::get<I>(stages_)(value);
+            if (!out) {
+                ++rejected_[I];
+                return std::nullopt;
+            }
+            return apply<I + 1>(*out);
+        }
+    }
+
+    std::tuple<Stages...> stages_;
+    std::array<uint32_t, stageCount> rejected_ = {};
+};
+} // namespace weather_station
@@ -0,0 +1,239 @@
+#include "FlashLog.h"
+#include "History.h"
+#include "Clock.h"
+#include "ino_compat.h"
+
+#include <pico/flash.h>
+
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+extern char __flash_binary_end;
+
+namespace weather_station
+{
+namespace
+{
+uint8_t crc8(const void* data, size_t size)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    uint8_t crc = 0xFF;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+struct ProgramRequest
+{
+    uint32_t offset;
+    const void* data;
+};
+
+void programPage(void* param)
+{
+    auto request = static_cast<const ProgramRequest*>(param);
+    flash_range_program(request->offset, static_cast<const uint8_t*>(request->data), FLASH_PAGE_SIZE);
+}
+
+void eraseSector(void* param)
+{
+    flash_range_erase(*static_cast<const uint32_t*>(param), FLASH_SECTOR_SIZE);
+}
+
+// Keeps core 1 parked in RAM and interrupts off while XIP is unavailable
+bool runFlashOp(void (*op)(void*), void* param, std::string_view what)
+{
+    auto rc = flash_safe_execute(op, param, 100);
+    if (rc != PICO_OK) {
+        std::cout << "Flash " << what << " failed: " << rc << "\n";
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+FlashLog::FlashLog()
+{
+    if (reinterpret_cast<uintptr_t>(&__flash_binary_end) > XIP_BASE + regionOffset) {
+        std::cout << "Firmware overlaps the flash log, log disabled\n";
+        return;
+    }
+    enabled_ = true;
+
+    bool found = false;
+    uint32_t newest = 0;
+    for (uint32_t i = 0; i < totalRecords; ++i) {
+        const auto& record = flashRecord(i);
+        if (!valid(record)) {
+            continue;
+        }
+        if (!found || record.sequence > sequence_) {
+            sequence_ = record.sequence;
+            newest = i;
+            found = true;
+        }
+        if (record.type == Type::Measurement) {
+            lastMeasurement_ = std::max(lastMeasurement_, record.sequence);
+        } else {
+            sent_ = std::max(sent_, record.stamp);
+        }
+    }
+    persistedSent_ = sent_;
+    writeIndex_ = found ? (newest + 1) % totalRecords : 0;
+    startPage();
+    // The oldest record is at the start of the sector after the one being written, the rest of that one is blank
+    oldestUnsent_ = (writeIndex_ / recordsPerSector + 1) * recordsPerSector % totalRecords;
+    skipSent();
+    std::cout << "Flash log resumed at sequence " << sequence_ << ", sent up to " << sent_ << "\n";
+}
+
+bool FlashLog::valid(const Record& record)
+{
+    return record.sequence != 0xFFFFFFFF &&
+           (record.type == Type::Measurement || record.type == Type::Sent) &&
+           record.crc == crc8(&record, offsetof(Record, crc));
+}
+
+const FlashLog::Record& FlashLog::flashRecord(uint32_t index)
+{
+    return reinterpret_cast<const Record*>(XIP_BASE + regionOffset)[index];
+}
+
+bool FlashLog::unsent(uint32_t index) const
+{
+    const auto& record = readRecord(index);
+    return valid(record) && record.type == Type::Measurement && record.sequence > sent_;
+}
+
+void FlashLog::skipSent()
+{
+    while (oldestUnsent_ != writeIndex_ && !unsent(oldestUnsent_)) {
+        oldestUnsent_ = (oldestUnsent_ + 1) % totalRecords;
+    }
+}
+
+const FlashLog::Record& FlashLog::readRecord(uint32_t index) const
+{
+    if (index >= pageStart_ && index < pageStart_ + recordsPerPage) {
+        return page_[index - pageStart_];
+    }
+    return flashRecord(index);
+}
+
+void FlashLog::startPage()
+{
+    pageStart_ = writeIndex_ - writeIndex_ % recordsPerPage;
+    if (writeIndex_ % recordsPerPage != 0) {
+        // Resuming a partially written page, programming the same bytes again leaves them unchanged
+        memcpy(page_.data(), &flashRecord(pageStart_), FLASH_PAGE_SIZE);
+        return;
+    }
+    memset(page_.data(), 0xFF, FLASH_PAGE_SIZE);
+    if (writeIndex_ % recordsPerSector != 0) {
+        // The rest of the sector was erased when the log entered it
+        return;
+    }
+
+    // Entering a new sector drops the oldest data it holds, unsent measurements included. If they are, the scans go on
+    // with the oldest measurements left.
+    if (hasUnsent() && oldestUnsent_ / recordsPerSector == writeIndex_ / recordsPerSector) {
+        oldestUnsent_ = (writeIndex_ + recordsPerSector) % totalRecords;
+    }
+    // Erasing is the slow part, skip it if already blank
+    auto sector = reinterpret_cast<const uint8_t*>(&flashRecord(writeIndex_));
+    bool blank = std::all_of(sector, sector + FLASH_SECTOR_SIZE, [](uint8_t b) { return b == 0xFF; });
+    if (!blank) {
+        uint32_t offset = regionOffset + writeIndex_ * sizeof(Record);
+        runFlashOp(eraseSector, &offset, "erase");
+    }
+}
+
+void FlashLog::touch()
+{
+    if (!pending()) {
+        pendingSince_ = millis();
+    }
+}
+
+uint32_t FlashLog::write(Record record)
+{
+    touch();
+    record.sequence = ++sequence_;
+    record.crc = crc8(&record, offsetof(Record, crc));
+    page_[writeIndex_ - pageStart_] = record;
+    dirty_ = true;
+
+    writeIndex_ = (writeIndex_ + 1) % totalRecords;
+    if (writeIndex_ % recordsPerPage == 0) {
+        // Not flush(), a Sent marker written from here would land past the end of the full page
+        program();
+        startPage();
+    }
+    return record.sequence;
+}
+
+uint32_t FlashLog::append(const Sensor::Measurement& measurement, uint64_t time)
+{
+    if (!enabled_) {
+        return 0;
+    }
+    auto point = History::toPoint(measurement);
+    Record record{};
+    record.stamp = Clock::toUtc(time) / 1000000;
+    record.co2 = point[0];
+    record.temperature = point[1];
+    record.humidity = point[2];
+    record.type = Type::Measurement;
+    lastMeasurement_ = write(record);
+    return lastMeasurement_;
+}
+
+void FlashLog::markSent(uint32_t sequence)
+{
+    if (!enabled_ || sequence <= sent_) {
+        return;
+    }
+    touch();
+    sent_ = sequence;
+    skipSent();
+}
+
+void FlashLog::process(uint64_t now)
+{
+    if (pending() && now - pendingSince_ > flushDelay) {
+        flush();
+    }
+}
+
+void FlashLog::flush()
+{
+    if (!enabled_) {
+        return;
+    }
+    if (sent_ != persistedSent_) {
+        persistedSent_ = sent_;
+        Record marker{};
+        marker.stamp = sent_;
+        marker.type = Type::Sent;
+        write(marker);
+    }
+    program();
+}
+
+void FlashLog::program()
+{
+    if (!dirty_) {
+        return;
+    }
+    ProgramRequest request{regionOffset + pageStart_ * static_cast<uint32_t>(sizeof(Record)), page_.data()};
+    if (runFlashOp(programPage, &request, "program")) {
+        dirty_ = false;
+    }
+}
+} // namespace weather_station
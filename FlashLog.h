@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Sensor.h"
+
+#include <hardware/flash.h>
+
+#include <array>
+#include <cstdint>
+
+namespace weather_station
+{
+// Append-only measurement log in a reserved region at the end of flash. Records are collected in a page buffer and
+// programmed a page at a time, sectors are erased (and the oldest data dropped) only when the log wraps into them.
+// Each record carries a sequence number and a CRC, so on boot the log resumes after the newest valid record.
+// Delivery is tracked with a watermark: everything up to sent() has reached the broker.
+class FlashLog
+{
+public:
+    enum class Type : uint8_t { Measurement = 1, Sent = 2 };
+
+    struct Record
+    {
+        uint32_t sequence;
+        uint32_t stamp; // UTC seconds for measurements (0 if taken before the clock was synced), acknowledged sequence for Sent markers
+        uint16_t co2;
+        int16_t temperature; // centi-degrees
+        uint16_t humidity;   // centi-percent
+        Type type;
+        uint8_t crc;
+    };
+    static_assert(sizeof(Record) == 16 && FLASH_PAGE_SIZE % sizeof(Record) == 0);
+
+    FlashLog();
+
+    // time is the time_us_64() of the sample
+    uint32_t append(const Sensor::Measurement& measurement, uint64_t time);
+    // Programs the page buffer once it has been dirty for a while
+    void process(uint64_t now);
+    void flush();
+
+    void markSent(uint32_t sequence);
+    uint32_t sent() const
+    {
+        return sent_;
+    }
+    bool hasUnsent() const
+    {
+        return lastMeasurement_ > sent_;
+    }
+    uint32_t lastMeasurement() const
+    {
+        return lastMeasurement_;
+    }
+
+    // f(record) for up to max unsent measurements, oldest first. Returns the number of records visited.
+    template <typename F>
+    size_t forEachUnsent(F&& f, size_t max) const
+    {
+        size_t visited = 0;
+        for (uint32_t i = oldestUnsent_; i != writeIndex_ && visited < max; i = (i + 1) % totalRecords) {
+            if (unsent(i)) {
+                f(readRecord(i));
+                ++visited;
+            }
+        }
+        return visited;
+    }
+
+private:
+    static constexpr uint32_t sectors = 32;
+    static constexpr uint32_t recordsPerPage = FLASH_PAGE_SIZE / sizeof(Record);
+    static constexpr uint32_t recordsPerSector = FLASH_SECTOR_SIZE / sizeof(Record);
+    static constexpr uint32_t totalRecords = sectors * recordsPerSector;
+    static constexpr uint32_t regionOffset = PICO_FLASH_SIZE_BYTES - sectors * FLASH_SECTOR_SIZE;
+    static constexpr uint64_t flushDelay = 60000;
+
+    static bool valid(const Record& record);
+    static const Record& flashRecord(uint32_t index);
+    const Record& readRecord(uint32_t index) const;
+
+    bool pending() const
+    {
+        return dirty_ || sent_ != persistedSent_;
+    }
+    void touch();
+    uint32_t write(Record record);
+    void program();
+    void startPage();
+    bool unsent(uint32_t index) const;
+    void skipSent();
+
+    std::array<Record, recordsPerPage> page_;
+    uint32_t pageStart_ = 0;
+    uint32_t writeIndex_ = 0;
+    // Nothing between the oldest record and this one is an unsent measurement, so the scans start here
+    uint32_t oldestUnsent_ = 0;
+    uint32_t sequence_ = 0;
+    uint32_t sent_ = 0;
+    uint32_t persistedSent_ = 0;
+    uint32_t lastMeasurement_ = 0;
+    uint64_t pendingSince_ = 0;
+    bool dirty_ = false;
+    bool enabled_ = false;
+};
+} // namespace weather_station
@@ -0,0 +1,160 @@
+#include "Gateway.h"
+#include "MQTT.h"
+#include "Network.h"
+#include "ino_compat.h"
+
+#include "pico/cyw43_arch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace weather_station
+{
+namespace
+{
+// A sequence this far behind the newest one means the peer lost its flash log and started over
+constexpr uint32_t restartDistance = 1000;
+} // namespace
+
+Gateway::Gateway(uint16_t port)
+    : port_(port)
+{
+    pending_.reserve(maxPending);
+}
+
+Gateway::~Gateway()
+{
+    if (pcb_) {
+        cyw43_arch_lwip_begin();
+        udp_remove(pcb_);
+        cyw43_arch_lwip_end();
+    }
+}
+
+bool Gateway::start()
+{
+    cyw43_arch_lwip_begin();
+    pcb_ = udp_new_ip_type(IPADDR_TYPE_ANY);
+    bool ok = pcb_ && udp_bind(pcb_, IP_ANY_TYPE, port_) == ERR_OK;
+    if (ok) {
+        udp_recv(pcb_, Gateway::receiveCallback, this);
+    }
+    cyw43_arch_lwip_end();
+    if (!ok) {
+        std::cout << "Gateway failed to bind UDP port " << port_ << "\n";
+        return false;
+    }
+    startedAt_ = millis();
+    std::cout << "Gateway listening for peers on UDP port " << port_ << "\n";
+    return true;
+}
+
+void Gateway::receive(pbuf* p)
+{
+    PeerReading reading;
+    bool valid = p->tot_len == sizeof(reading) &&
+                 pbuf_copy_partial(p, &reading, sizeof(reading), 0) == sizeof(reading) &&
+                 reading.header == PeerReading::magic && reading.version == PeerReading::currentVersion;
+    pbuf_free(p);
+    ++received_;
+    if (!valid) {
+        ++malformed_;
+        return;
+    }
+    reading.station.back() = '\0';
+    if (!accept(reading)) {
+        ++duplicates_;
+        return;
+    }
+    if (pending_.size() >= maxPending) {
+        // MQTT has been down for a while, the newest readings are dropped
+        ++dropped_;
+        return;
+    }
+    if (pending_.empty()) {
+        firstPending_ = millis();
+    }
+    pending_.push_back(reading);
+}
+
+bool Gateway::accept(const PeerReading& reading)
+{
+    auto now = millis();
+    auto peer = std::find_if(peers_.begin(), peers_.end(), [&](const Peer& p) { return p.station == reading.station; });
+    if (peer == peers_.end()) {
+        // New station, take the slot of the one not heard from the longest
+        peer = std::min_element(peers_.begin(), peers_.end(), [](const Peer& a, const Peer& b) {
+            return a.lastHeard < b.lastHeard;
+        });
+        *peer = Peer{reading.station, reading.sequence, 1, now};
+        return true;
+    }
+    peer->lastHeard = now;
+    if (reading.sequence == 0) {
+        // The peer has no flash log to number its readings, nothing to deduplicate on
+        return true;
+    }
+    if (reading.sequence > peer->highest) {
+        auto shift = reading.sequence - peer->highest;
+        peer->seen = shift >= 32 ? 1 : (peer->seen << shift) | 1;
+        peer->highest = reading.sequence;
+        return true;
+    }
+    auto behind = peer->highest - reading.sequence;
+    if (behind >= restartDistance) {
+        peer->highest = reading.sequence;
+        peer->seen = 1;
+        return true;
+    }
+    if (behind >= 32 || (peer->seen & (1u << behind))) {
+        return false;
+    }
+    peer->seen |= 1u << behind;
+    return true;
+}
+
+void Gateway::process(uint64_t now, MQTT& mqtt)
+{
+    if (!mqtt.Ready()) {
+        return;
+    }
+    std::vector<PeerReading> batch;
+    cyw43_arch_lwip_begin();
+    if (!pending_.empty() && (pending_.size() >= batchSize || now - firstPending_ >= batchAge)) {
+        auto count = std::min(pending_.size(), batchSize);
+        batch.assign(pending_.begin(), pending_.begin() + count);
+        pending_.erase(pending_.begin(), pending_.begin() + count);
+        firstPending_ = now;
+    }
+    cyw43_arch_lwip_end();
+    if (batch.empty()) {
+        return;
+    }
+
+    // Same columns as the backlog, prefixed with the station
+    std::stringstream ss;
+    for (const auto& reading : batch) {
+        ss << reading.station.data() << "," << reading.sequence << "," << reading.stamp << "," << reading.co2 << ","
+           << reading.temperature << "," << reading.humidity << "\n";
+    }
+    mqtt.ReportPeers(ss.str());
+    forwarded_ += batch.size();
+    ++batches_;
+}
+
+void Gateway::printStats(uint64_t now) const
+{
+    auto minutes = (now - startedAt_) / 60000.0f;
+    if (startedAt_ == 0 || minutes <= 0) {
+        return;
+    }
+    auto active = std::count_if(peers_.begin(), peers_.end(), [&](const Peer& p) {
+        return p.lastHeard != 0 && now - p.lastHeard < 10 * 60000;
+    });
+    std::cout << "Gateway: " << active << " active peers on 1 broker connection, " << received_ / minutes
+              << " datagrams/min in (" << duplicates_ << " duplicate, " << malformed_ << " malformed, " << dropped_
+              << " dropped), " << forwarded_ << " readings in " << batches_ / minutes << " MQTT messages/min out\n";
+}
+} // namespace weather_station
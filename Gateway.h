@@ -0,0 +1,71 @@
+#pragma once
+
+#include "PeerReading.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace weather_station
+{
+class MQTT;
+
+// Gateway role: peer stations on the LAN send PeerReadings over UDP instead of keeping their own broker connection.
+// Readings are deduplicated per station by sequence number (peers may retransmit, datagrams may be duplicated) and
+// forwarded upstream in batches over the gateway's MQTT session on home/weather_station/peers.
+class Gateway
+{
+public:
+    explicit Gateway(uint16_t port);
+    ~Gateway();
+
+    bool start();
+    // Forwards a batch once it is full or old enough and MQTT is idle
+    void process(uint64_t now, MQTT& mqtt);
+    void printStats(uint64_t now) const;
+
+private:
+    void receive(pbuf* p);
+    static void receiveCallback(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, u16_t port)
+    {
+        static_cast<Gateway*>(arg)->receive(p);
+    }
+
+    // True if the reading has not been seen before
+    bool accept(const PeerReading& reading);
+
+    struct Peer
+    {
+        std::array<char, 12> station = {};
+        uint32_t highest = 0;
+        // Bit n set: highest - n has been seen, tolerates reordering within the window
+        uint32_t seen = 0;
+        uint64_t lastHeard = 0;
+    };
+
+    static constexpr size_t maxPeers = 16;
+    static constexpr size_t batchSize = 16;
+    static constexpr size_t maxPending = 128;
+    static constexpr uint64_t batchAge = 10000;
+
+    const uint16_t port_;
+    udp_pcb* pcb_ = nullptr;
+
+    // Touched from the lwIP callback, read by process() under the lwIP lock
+    std::array<Peer, maxPeers> peers_;
+    std::vector<PeerReading> pending_;
+    uint64_t firstPending_ = 0;
+
+    uint32_t received_ = 0;
+    uint32_t duplicates_ = 0;
+    uint32_t malformed_ = 0;
+    uint32_t dropped_ = 0;
+    uint32_t forwarded_ = 0;
+    uint32_t batches_ = 0;
+    uint64_t startedAt_ = 0;
+};
+} // namespace weather_station
@@ -0,0 +1,151 @@
+#include "History.h"
+
+#include <algorithm>
+
+namespace weather_station
+{
+namespace
+{
+constexpr uint32_t secondPeriod = 1000;
+constexpr uint32_t minutePeriod = 60 * secondPeriod;
+constexpr uint32_t quarterPeriod = 15 * minutePeriod;
+constexpr uint32_t secondsPerMinute = minutePeriod / secondPeriod;
+// Missed seconds filled in after a stall, beyond that the gap is left
+constexpr uint64_t maxCatchUp = 60;
+// A longer gap leaves every tier empty
+constexpr uint64_t maxGap = 2881 * (quarterPeriod / secondPeriod);
+} // namespace
+
+History::History()
+    : seconds_(secondPeriod)
+    , minutes_(minutePeriod)
+    , quarters_(quarterPeriod)
+{
+}
+
+HistoryPoint History::toPoint(const Sensor::Measurement& measurement)
+{
+    return {measurement.CO2, measurement.Temperature, measurement.Humidity};
+}
+
+void History::Accumulator::add(const HistoryPoint& point)
+{
+    for (size_t m = 0; m < point.size(); ++m) {
+        sum[m] += point[m];
+    }
+    ++count;
+}
+
+HistoryPoint History::Accumulator::take()
+{
+    HistoryPoint mean;
+    for (size_t m = 0; m < mean.size(); ++m) {
+        mean[m] = sum[m] / count;
+        sum[m] = 0;
+    }
+    count = 0;
+    ticks = 0;
+    return mean;
+}
+
+void History::add(uint64_t now, const Sensor::Measurement& measurement)
+{
+    if (lastTick_ != 0 && now - lastTick_ < secondPeriod) {
+        return;
+    }
+    auto point = toPoint(measurement);
+    if (lastTick_ == 0) {
+        lastTick_ = now;
+        tick(now, &point);
+        return;
+    }
+    // Ticks stay on the 1 s grid, the tiers reconstruct sample times from it. Seconds missed in a stall are filled with
+    // the current sample, a longer gap is kept as one.
+    auto ticks = (now - lastTick_) / secondPeriod;
+    if (ticks > maxCatchUp) {
+        skip(ticks - 1);
+        ticks = 1;
+    }
+    for (; ticks > 0; --ticks) {
+        lastTick_ += secondPeriod;
+        tick(lastTick_, &point);
+    }
+}
+
+void History::tick(uint64_t time, const HistoryPoint* sample)
+{
+    if (sample) {
+        seconds_.push(*sample, time);
+        toMinutes_.add(*sample);
+    } else {
+        seconds_.pushGaps(1, time);
+    }
+    if (++toMinutes_.ticks == secondsPerMinute) {
+        endMinute(time);
+    }
+}
+
+void History::endMinute(uint64_t time)
+{
+    // A period with at least one sample gets their mean, one without is a gap in the coarser tier as well
+    if (toMinutes_.count > 0) {
+        auto point = toMinutes_.take();
+        minutes_.push(point, time);
+        toQuarters_.add(point);
+    } else {
+        toMinutes_.ticks = 0;
+        minutes_.pushGaps(1, time);
+    }
+    if (++toQuarters_.ticks < quarterPeriod / minutePeriod) {
+        return;
+    }
+    if (toQuarters_.count > 0) {
+        quarters_.push(toQuarters_.take(), time);
+    } else {
+        toQuarters_.ticks = 0;
+        quarters_.pushGaps(1, time);
+    }
+}
+
+// Seconds without a sample after a stall, whole minutes at a time where possible
+void History::skip(uint64_t ticks)
+{
+    if (ticks > maxGap) {
+        // Everything before is pushed out by the gap anyway
+        lastTick_ += (ticks - maxGap) * secondPeriod;
+        ticks = maxGap;
+    }
+    while (ticks > 0) {
+        if (toMinutes_.ticks == 0 && ticks >= secondsPerMinute) {
+            lastTick_ += minutePeriod;
+            seconds_.pushGaps(secondsPerMinute, lastTick_);
+            endMinute(lastTick_);
+            ticks -= secondsPerMinute;
+        } else {
+            lastTick_ += secondPeriod;
+            tick(lastTick_, nullptr);
+            --ticks;
+        }
+    }
+}
+
+History::Range History::range(Metric metric, uint64_t since) const
+{
+    Range range;
+    auto update = [&range](uint64_t, int32_t value) {
+        if (!range.valid) {
+            range = {value, value, true};
+            return;
+        }
+        range.min = std::min(range.min, value);
+        range.max = std::max(range.max, value);
+    };
+    auto m = static_cast<size_t>(metric);
+    auto secondsStart = seconds_.startTime();
+    auto minutesStart = std::min(secondsStart, minutes_.startTime());
+    quarters_.forEachValue(m, since, minutesStart, update);
+    minutes_.forEachValue(m, since, secondsStart, update);
+    seconds_.forEachValue(m, since, std::numeric_limits<uint64_t>::max(), update);
+    return range;
+}
+} // namespace weather_station
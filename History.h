@@ -0,0 +1,249 @@
+#pragma once
+
+#include "Sensor.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+
+namespace weather_station
+{
+// Fixed-point sample: CO2 in ppm, temperature in centi-degrees, humidity in centi-percent
+using HistoryPoint = std::array<int32_t, 3>;
+
+// Ring buffer of delta-encoded samples taken every period_ ms. The absolute value of the oldest and the newest sample
+// is kept aside, each slot holds the difference to the previous sample. Deltas of a metric are contiguous
+// (structure of arrays) so scanning a single metric touches as little memory as possible. Sample times are derived
+// from their position, so periods without a sample take a slot too: a gap marker, which the iteration skips.
+template <size_t N>
+class HistoryTier
+{
+public:
+    explicit HistoryTier(uint32_t period)
+        : period_(period)
+    {
+    }
+
+    void push(const HistoryPoint& point, uint64_t now)
+    {
+        newestTime_ = now;
+        gapRun_ = 0;
+        if (size_ == 0) {
+            oldest_ = newest_ = point;
+            start_ = 0;
+            size_ = 1;
+            for (auto& deltas : deltas_) {
+                deltas[start_] = 0;
+            }
+            return;
+        }
+        auto idx = append();
+        for (size_t m = 0; m < point.size(); ++m) {
+            // Delta against what we actually stored, so a clamped step is caught up on the next sample
+            int32_t delta = point[m] - newest_[m];
+            if (delta > std::numeric_limits<int16_t>::max()) {
+                delta = std::numeric_limits<int16_t>::max();
+            } else if (delta <= gapDelta) {
+                delta = gapDelta + 1;
+            }
+            deltas_[m][idx] = delta;
+            newest_[m] += delta;
+        }
+    }
+
+    // count periods without a sample up to now. Once the tier holds nothing but gaps it is emptied and the next push
+    // starts it again.
+    void pushGaps(size_t count, uint64_t now)
+    {
+        if (size_ == 0) {
+            return;
+        }
+        newestTime_ = now;
+        for (; count > 0 && gapRun_ < N; --count, ++gapRun_) {
+            auto idx = append();
+            for (auto& deltas : deltas_) {
+                deltas[idx] = 0;
+            }
+            deltas_[0][idx] = gapDelta;
+        }
+        if (gapRun_ >= N) {
+            size_ = 0;
+        }
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+    uint32_t period() const
+    {
+        return period_;
+    }
+    uint64_t oldestTime() const
+    {
+        return newestTime_ - static_cast<uint64_t>(size_ - 1) * period_;
+    }
+    // Time of the oldest sample, the end of time for an empty tier
+    uint64_t startTime() const
+    {
+        return size_ > 0 ? oldestTime() : std::numeric_limits<uint64_t>::max();
+    }
+
+    // f(time, value) for one metric and since <= time < until, oldest first
+    template <typename F>
+    void forEachValue(size_t metric, uint64_t since, uint64_t until, F&& f) const
+    {
+        if (size_ == 0) {
+            return;
+        }
+        const auto& deltas = deltas_[metric];
+        int32_t value = oldest_[metric];
+        uint64_t time = oldestTime();
+        for (size_t k = 0; k < size_ && time < until; ++k, time += period_) {
+            auto slot = (start_ + k) % N;
+            if (gap(slot)) {
+                continue;
+            }
+            if (k > 0) {
+                value += deltas[slot];
+            }
+            if (time >= since) {
+                f(time, value);
+            }
+        }
+    }
+
+    // f(time, point) for all metrics and since <= time < until, oldest first. If f returns bool, returning false stops
+    // the iteration and makes forEach return false.
+    template <typename F>
+    bool forEach(uint64_t since, uint64_t until, F&& f) const
+    {
+        if (size_ == 0) {
+            return true;
+        }
+        HistoryPoint point = oldest_;
+        uint64_t time = oldestTime();
+        for (size_t k = 0; k < size_ && time < until; ++k, time += period_) {
+            auto slot = (start_ + k) % N;
+            if (gap(slot)) {
+                continue;
+            }
+            if (k > 0) {
+                for (size_t m = 0; m < point.size(); ++m) {
+                    point[m] += deltas_[m][slot];
+                }
+            }
+            if (time < since) {
+                continue;
+            }
+            if constexpr (std::is_same_v<std::invoke_result_t<F&, uint64_t, const HistoryPoint&>, bool>) {
+                if (!f(time, point)) {
+                    return false;
+                }
+            } else {
+                f(time, point);
+            }
+        }
+        return true;
+    }
+
+private:
+    // In the first metric of a gap marker, the other metrics of a marker are 0 so values carry over it
+    static constexpr int16_t gapDelta = std::numeric_limits<int16_t>::min();
+
+    bool gap(size_t slot) const
+    {
+        return deltas_[0][slot] == gapDelta;
+    }
+
+    // Slot for one more sample, dropping the oldest if the tier is full
+    size_t append()
+    {
+        if (size_ == N) {
+            start_ = (start_ + 1) % N;
+            if (!gap(start_)) {
+                for (size_t m = 0; m < oldest_.size(); ++m) {
+                    oldest_[m] += deltas_[m][start_];
+                }
+            }
+            --size_;
+        }
+        return (start_ + size_++) % N;
+    }
+
+    std::array<std::array<int16_t, N>, std::tuple_size_v<HistoryPoint>> deltas_{};
+    HistoryPoint oldest_{};
+    HistoryPoint newest_{};
+    uint64_t newestTime_ = 0;
+    const uint32_t period_;
+    uint16_t start_ = 0;
+    uint16_t size_ = 0;
+    // Gap markers since the last sample
+    uint16_t gapRun_ = 0;
+};
+
+// 1 s for 10 minutes, 1 min for 24 hours and 15 min for 30 days. Coarser tiers receive the mean of the finer one.
+class History
+{
+public:
+    enum class Metric { CO2, Temperature, Humidity };
+
+    struct Range
+    {
+        int32_t min = 0;
+        int32_t max = 0;
+        bool valid = false;
+    };
+
+    History();
+
+    static HistoryPoint toPoint(const Sensor::Measurement& measurement);
+
+    // Call as often as convenient, samples are taken once per second
+    void add(uint64_t now, const Sensor::Measurement& measurement);
+
+    Range range(Metric metric, uint64_t since) const;
+
+    // f(time, point) from since on, oldest first. Every tier covers the time before the next finer one starts, so
+    // each part of the range comes from the finest tier that still holds it.
+    template <typename F>
+    void forEach(uint64_t since, F&& f) const
+    {
+        auto secondsStart = seconds_.startTime();
+        auto minutesStart = std::min(secondsStart, minutes_.startTime());
+        quarters_.forEach(since, minutesStart, f) && minutes_.forEach(since, secondsStart, f) &&
+            seconds_.forEach(since, std::numeric_limits<uint64_t>::max(), f);
+    }
+
+private:
+    struct Accumulator
+    {
+        std::array<int32_t, std::tuple_size_v<HistoryPoint>> sum{};
+        // Samples, and periods of the finer tier with or without one
+        uint16_t count = 0;
+        uint16_t ticks = 0;
+
+        void add(const HistoryPoint& point);
+        HistoryPoint take();
+    };
+
+    // One second, sample is null if there is none
+    void tick(uint64_t time, const HistoryPoint* sample);
+    // The minute ending at time is complete
+    void endMinute(uint64_t time);
+    void skip(uint64_t ticks);
+
+    HistoryTier<600> seconds_;
+    HistoryTier<1440> minutes_;
+    HistoryTier<2880> quarters_;
+    Accumulator toMinutes_;
+    Accumulator toQuarters_;
+    uint64_t lastTick_ = 0;
+};
+
+static_assert(sizeof(History) <= 32 * 1024, "History exceeds its RAM budget");
+} // namespace weather_station
@@ -0,0 +1,291 @@
+#include "HttpServer.h"
+#include "Network.h"
+#include "Clock.h"
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include <iostream>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace weather_station
+{
+namespace
+{
+// Appends to the chunk, leaves it untouched and returns false if the text does not fit
+bool append(char* buf, size_t& size, size_t capacity, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf + size, capacity - size, format, args);
+    va_end(args);
+    if (n < 0 || size + n >= capacity) {
+        buf[size] = 0;
+        return false;
+    }
+    size += n;
+    return true;
+}
+
+bool startsWith(const char* s, const char* prefix)
+{
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+// "/metrics" matches "/metrics", "/metrics?x" and "/metrics HTTP/1.1" but not "/metricsfoo"
+bool matchPath(const char* path, const char* route)
+{
+    auto len = strlen(route);
+    return strncmp(path, route, len) == 0 && (path[len] == ' ' || path[len] == '?' || path[len] == 0);
+}
+
+constexpr const char* jsonHeader = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nConnection: close\r\n\r\n";
+} // namespace
+
+HttpServer::HttpServer(const History& history, uint16_t port)
+    : history_(history)
+    , port_(port)
+{
+}
+
+HttpServer::~HttpServer()
+{
+    cyw43_arch_lwip_begin();
+    for (auto& connection : connections_) {
+        close(connection);
+    }
+    if (listener_) {
+        tcp_close(listener_);
+    }
+    cyw43_arch_lwip_end();
+}
+
+bool HttpServer::start()
+{
+    cyw43_arch_lwip_begin();
+    auto pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+    if (pcb && tcp_bind(pcb, IP_ANY_TYPE, port_) == ERR_OK) {
+        listener_ = tcp_listen_with_backlog(pcb, 2);
+    }
+    if (listener_) {
+        tcp_arg(listener_, this);
+        tcp_accept(listener_, &HttpServer::acceptCallback);
+    } else if (pcb) {
+        tcp_close(pcb);
+    }
+    cyw43_arch_lwip_end();
+    if (!listener_) {
+        std::cout << "HTTP server failed to listen on port " << port_ << "\n";
+        return false;
+    }
+    std::cout << "HTTP server listening on port " << port_ << "\n";
+    return true;
+}
+
+void HttpServer::update(const Sensor::Measurement& measurement, uint64_t time, uint64_t now)
+{
+    measurement_ = measurement;
+    sampleTime_ = time;
+    measurementTime_ = now;
+}
+
+err_t HttpServer::accept(tcp_pcb* pcb, err_t err)
+{
+    if (err != ERR_OK || !pcb) {
+        return ERR_VAL;
+    }
+    for (auto& connection : connections_) {
+        if (connection.pcb) {
+            continue;
+        }
+        connection = Connection{};
+        connection.server = this;
+        connection.pcb = pcb;
+        tcp_arg(pcb, &connection);
+        tcp_recv(pcb, &HttpServer::recvCallback);
+        tcp_sent(pcb, &HttpServer::sentCallback);
+        tcp_err(pcb, &HttpServer::errCallback);
+        tcp_poll(pcb, &HttpServer::pollCallback, 4);
+        return ERR_OK;
+    }
+    // All slots busy, refuse rather than queue
+    tcp_abort(pcb);
+    return ERR_ABRT;
+}
+
+err_t HttpServer::recv(Connection& connection, pbuf* p, err_t err)
+{
+    if (!p) {
+        return close(connection);
+    }
+    tcp_recved(connection.pcb, p->tot_len);
+    if (connection.route != Route::None) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    auto& request = connection.request;
+    auto n = std::min<size_t>(p->tot_len, request.size() - 1 - connection.requestSize);
+    pbuf_copy_partial(p, request.data() + connection.requestSize, n, 0);
+    pbuf_free(p);
+    connection.requestSize += n;
+    request[connection.requestSize] = 0;
+    // Only the request line matters, the rest of the request is ignored
+    if (!strstr(request.data(), "\r\n") && connection.requestSize < request.size() - 1) {
+        return ERR_OK;
+    }
+    route(connection);
+    ++requests_;
+    return pump(connection);
+}
+
+void HttpServer::route(Connection& connection)
+{
+    const char* line = connection.request.data();
+    connection.route = Route::NotFound;
+    if (!startsWith(line, "GET ")) {
+        return;
+    }
+    const char* path = line + 4;
+    if (matchPath(path, "/metrics")) {
+        connection.route = Route::Metrics;
+    } else if (matchPath(path, "/current")) {
+        connection.route = Route::Current;
+    } else if (matchPath(path, "/history")) {
+        connection.route = Route::History;
+        auto end = strchr(path, ' ');
+        auto from = strstr(path, "from=");
+        if (from && (!end || from < end)) {
+            auto seconds = strtoull(from + 5, nullptr, 10);
+            connection.cursor = Clock::synced() ? Clock::toMonotonic(seconds * 1000000) / 1000 : seconds * 1000;
+        }
+    }
+}
+
+err_t HttpServer::pump(Connection& connection)
+{
+    if (!connection.pcb || connection.route == Route::None) {
+        return ERR_OK;
+    }
+    connection.idlePolls = 0;
+    // Generate only while a whole chunk fits, so a generated chunk is never dropped
+    while (tcp_sndbuf(connection.pcb) >= chunk_.size() && tcp_sndqueuelen(connection.pcb) < TCP_SND_QUEUELEN - 2) {
+        size_t size = 0;
+        bool more = generate(connection, size, chunk_.size());
+        if (size > 0) {
+            auto flags = TCP_WRITE_FLAG_COPY | (more ? TCP_WRITE_FLAG_MORE : 0);
+            if (tcp_write(connection.pcb, chunk_.data(), size, flags) != ERR_OK) {
+                std::cout << "HTTP write failed, dropping connection\n";
+                tcp_abort(connection.pcb);
+                connection.pcb = nullptr;
+                return ERR_ABRT;
+            }
+        }
+        if (!more) {
+            // Queued data still goes out before the FIN
+            return close(connection);
+        }
+    }
+    tcp_output(connection.pcb);
+    return ERR_OK;
+}
+
+bool HttpServer::generate(Connection& connection, size_t& size, size_t capacity)
+{
+    char* buf = chunk_.data();
+    const auto& m = measurement_;
+    const auto& station = Network::stationId();
+    CentiText temperature(m.Temperature);
+    CentiText humidity(m.Humidity);
+    switch (connection.route) {
+        case Route::Metrics:
+            append(
+                buf, size, capacity,
+                "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n"
+                "# TYPE weather_co2_ppm gauge\nweather_co2_ppm{station=\"%s\"} %u\n"
+                "# TYPE weather_temperature_celsius gauge\nweather_temperature_celsius{station=\"%s\"} %s\n"
+                "# TYPE weather_humidity_percent gauge\nweather_humidity_percent{station=\"%s\"} %s\n"
+                "# TYPE weather_uptime_seconds counter\nweather_uptime_seconds{station=\"%s\"} %llu\n"
+                "# TYPE weather_http_requests_total counter\nweather_http_requests_total{station=\"%s\"} %lu\n",
+                station.c_str(), m.CO2, station.c_str(), temperature.c_str(), station.c_str(), humidity.c_str(),
+                station.c_str(),
+                measurementTime_ / 1000, station.c_str(), static_cast<unsigned long>(requests_)
+            );
+            return false;
+        case Route::Current:
+            append(
+                buf, size, capacity,
+                "%s{\"station\":\"%s\",\"uptime\":%llu,\"time\":%llu,\"co2\":%u,\"temperature\":%s,"
+                "\"humidity\":%s}\n",
+                jsonHeader, station.c_str(), measurementTime_ / 1000, Clock::toUtc(sampleTime_) / 1000, m.CO2,
+                temperature.c_str(), humidity.c_str()
+            );
+            return false;
+        case Route::History:
+            return generateHistory(connection, size, capacity);
+        default:
+            append(
+                buf, size, capacity,
+                "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\nNot found\n"
+            );
+            return false;
+    }
+}
+
+bool HttpServer::generateHistory(Connection& connection, size_t& size, size_t capacity)
+{
+    char* buf = chunk_.data();
+    if (!connection.headerSent) {
+        append(buf, size, capacity, "%s[", jsonHeader);
+        connection.headerSent = true;
+    }
+    bool full = false;
+    history_.forEach(connection.cursor, [&](uint64_t time, const HistoryPoint& point) {
+        auto temp = std::abs(point[1]);
+        auto hum = std::abs(point[2]);
+        if (!append(
+                buf, size, capacity, "%s[%llu,%ld,%s%ld.%02ld,%ld.%02ld]", connection.first ? "" : ",",
+                Clock::synced() ? Clock::toUtc(time * 1000) / 1000000 : time / 1000,
+                static_cast<long>(point[0]), point[1] < 0 ? "-" : "", static_cast<long>(temp / 100),
+                static_cast<long>(temp % 100), static_cast<long>(hum / 100), static_cast<long>(hum % 100)
+            )) {
+            full = true;
+            return false;
+        }
+        connection.first = false;
+        connection.cursor = time + 1;
+        return true;
+    });
+    return full || !append(buf, size, capacity, "]\n");
+}
+
+err_t HttpServer::poll(Connection& connection)
+{
+    // Called every 2 seconds, drop clients that stall for 10
+    if (++connection.idlePolls > 5) {
+        return close(connection);
+    }
+    return pump(connection);
+}
+
+err_t HttpServer::close(Connection& connection)
+{
+    if (!connection.pcb) {
+        return ERR_OK;
+    }
+    auto pcb = connection.pcb;
+    connection.pcb = nullptr;
+    tcp_arg(pcb, nullptr);
+    tcp_recv(pcb, nullptr);
+    tcp_sent(pcb, nullptr);
+    tcp_err(pcb, nullptr);
+    tcp_poll(pcb, nullptr, 0);
+    if (tcp_close(pcb) != ERR_OK) {
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    return ERR_OK;
+}
+} // namespace weather_station
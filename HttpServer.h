@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Sensor.h"
+#include "History.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+
+#include <array>
+#include <cstdint>
+
+namespace weather_station
+{
+// Minimal HTTP/1.1 server on the lwIP raw API:
+//   /metrics        Prometheus text format
+//   /current        JSON with the latest reading
+//   /history?from=  JSON array of [time, co2, temperature, humidity] from the in-memory history. Times (and from) are
+//                   UTC seconds once the clock is synced, seconds since boot before that.
+// Responses are generated a chunk at a time while the send buffer has room, so a response never exists in full and
+// RAM use is bounded by the number of connection slots.
+class HttpServer
+{
+public:
+    HttpServer(const History& history, uint16_t port = 80);
+    ~HttpServer();
+
+    bool start();
+
+    // Latest reading to serve and its time_us_64(), call with the lwIP lock held
+    void update(const Sensor::Measurement& measurement, uint64_t time, uint64_t now);
+
+private:
+    enum class Route { None, Metrics, Current, History, NotFound };
+
+    struct Connection
+    {
+        HttpServer* server = nullptr;
+        tcp_pcb* pcb = nullptr;
+        Route route = Route::None;
+        std::array<char, 128> request;
+        size_t requestSize = 0;
+        bool headerSent = false;
+        bool first = true;
+        uint64_t cursor = 0;
+        uint8_t idlePolls = 0;
+    };
+
+    static err_t acceptCallback(void* arg, tcp_pcb* pcb, err_t err)
+    {
+        return static_cast<HttpServer*>(arg)->accept(pcb, err);
+    }
+    static err_t recvCallback(void* arg, tcp_pcb* pcb, pbuf* p, err_t err)
+    {
+        auto connection = static_cast<Connection*>(arg);
+        return connection->server->recv(*connection, p, err);
+    }
+    static err_t sentCallback(void* arg, tcp_pcb* pcb, u16_t len)
+    {
+        auto connection = static_cast<Connection*>(arg);
+        return connection->server->pump(*connection);
+    }
+    static err_t pollCallback(void* arg, tcp_pcb* pcb)
+    {
+        auto connection = static_cast<Connection*>(arg);
+        return connection->server->poll(*connection);
+    }
+    static void errCallback(void* arg, err_t err)
+    {
+        // lwIP has freed the pcb already
+        auto connection = static_cast<Connection*>(arg);
+        connection->pcb = nullptr;
+    }
+
+    err_t accept(tcp_pcb* pcb, err_t err);
+    err_t recv(Connection& connection, pbuf* p, err_t err);
+    err_t poll(Connection& connection);
+    err_t pump(Connection& connection);
+    err_t close(Connection& connection);
+
+    void route(Connection& connection);
+    // Fills chunk_ with the next part of the response, returns false once the response is complete
+    bool generate(Connection& connection, size_t& size, size_t capacity);
+    bool generateHistory(Connection& connection, size_t& size, size_t capacity);
+
+    const History& history_;
+    const uint16_t port_;
+    tcp_pcb* listener_ = nullptr;
+    std::array<Connection, 4> connections_;
+    // Shared by all connections, tcp_write copies out of it
+    std::array<char, 512> chunk_;
+
+    Sensor::Measurement measurement_;
+    uint64_t sampleTime_ = 0;
+    uint64_t measurementTime_ = 0;
+    uint32_t requests_ = 0;
+};
+} // namespace weather_station
@@ -0,0 +1,297 @@
+#include "I2CBus.h"
+#include "Topology.h"
+#ifdef SCD_EMULATOR
+#include "ScdEmulator.h"
+#endif
+
+#include <pico/stdlib.h>
+#include <hardware/dma.h>
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <memory>
+
+namespace weather_station
+{
+namespace
+{
+constexpr int pending = 1;
+
+std::array<std::unique_ptr<I2CBus>, I2CBus::busCount> buses;
+} // namespace
+
+I2CBus& I2CBus::bus(unsigned index)
+{
+    auto& bus = buses[index];
+    if (!bus) {
+        bus = std::make_unique<I2CBus>(index, 100 * 1000);
+    }
+    return *bus;
+}
+
+void I2CBus::processAll()
+{
+    for (auto& bus : buses) {
+        if (bus) {
+            bus->process();
+        }
+    }
+}
+
+bool I2CBus::anyBusy()
+{
+    return std::any_of(buses.begin(), buses.end(), [](const auto& bus) { return bus && bus->busy(); });
+}
+
+void I2CBus::printAllStats()
+{
+    for (auto& bus : buses) {
+        if (bus) {
+            bus->printStats();
+        }
+    }
+}
+
+I2CBus::I2CBus(unsigned index, unsigned baudrate)
+    : index_(index)
+    , i2c_(index == 0 ? i2c0 : i2c1)
+    , baudrate_(baudrate)
+{
+    stats_.since = time_us_64();
+#ifndef SCD_EMULATOR
+    auto sda = i2cPins[index].sda;
+    auto scl = i2cPins[index].scl;
+    // i2c_init() also enables the DMA handshake of the controller
+    i2c_init(i2c_, baudrate_);
+    gpio_set_function(sda, GPIO_FUNC_I2C);
+    gpio_set_function(scl, GPIO_FUNC_I2C);
+    gpio_pull_up(sda);
+    gpio_pull_up(scl);
+    txChannel_ = dma_claim_unused_channel(true);
+    rxChannel_ = dma_claim_unused_channel(true);
+#endif
+}
+
+bool I2CBus::busy() const
+{
+    return active_ || std::any_of(slots_.begin(), slots_.end(), [](const Slot& slot) {
+               return slot.phase != Phase::Free;
+           });
+}
+
+void I2CBus::clockChanged()
+{
+#ifndef SCD_EMULATOR
+    i2c_set_baudrate(i2c_, baudrate_);
+#endif
+}
+
+bool I2CBus::submit(const Transaction& transaction)
+{
+    if (transaction.txLen > maxTransfer || transaction.rxLen > maxTransfer ||
+        (transaction.txLen == 0 && transaction.rxLen == 0)) {
+        ++stats_.rejected;
+        return false;
+    }
+    uint32_t queued = 0;
+    Slot* free = nullptr;
+    for (auto& slot : slots_) {
+        if (slot.phase != Phase::Free) {
+            ++queued;
+        } else if (!free) {
+            free = &slot;
+        }
+    }
+    if (!free) {
+        ++stats_.rejected;
+        return false;
+    }
+    free->transaction = transaction;
+    free->phase = transaction.txLen > 0 ? Phase::Write : Phase::Read;
+    free->order = nextOrder_++;
+    free->submitted = time_us_64();
+    free->notBefore = 0;
+    stats_.maxQueued = std::max(stats_.maxQueued, queued + 1);
+    return true;
+}
+
+int I2CBus::transfer(const Transaction& transaction)
+{
+    volatile int result = pending;
+    auto blocking = transaction;
+    blocking.done = [](void* arg, int r) { *static_cast<volatile int*>(arg) = r; };
+    blocking.arg = const_cast<int*>(&result);
+    if (!submit(blocking)) {
+        return timeoutError;
+    }
+    while (result == pending) {
+        process();
+    }
+    return result;
+}
+
+void I2CBus::process()
+{
+    auto now = time_us_64();
+    if (active_) {
+        auto result = poll(now);
+        if (result == pending) {
+            return;
+        }
+        stats_.busyUs += now - phaseStart_;
+        auto& slot = *active_;
+        active_ = nullptr;
+        if (result == 0 && slot.phase == Phase::Write && slot.transaction.rxLen > 0) {
+            // The device executes the command, the bus is free for others meanwhile
+            slot.phase = Phase::Wait;
+            slot.notBefore = now + slot.transaction.delayUs;
+        } else {
+            finish(slot, result);
+        }
+    }
+    if (auto slot = next(now)) {
+        start(*slot, now);
+    }
+}
+
+I2CBus::Slot* I2CBus::next(uint64_t now)
+{
+    Slot* best = nullptr;
+    for (auto& candidate : slots_) {
+        if (candidate.phase == Phase::Free || (best && candidate.order > best->order)) {
+            continue;
+        }
+        if (candidate.phase == Phase::Wait && now < candidate.notBefore) {
+            continue;
+        }
+        // Transactions of one device run in order, an older one still waiting for its device blocks the newer ones
+        bool blocked = false;
+        for (const auto& other : slots_) {
+            if (other.phase != Phase::Free && other.transaction.address == candidate.transaction.address &&
+                other.order < candidate.order) {
+                blocked = true;
+                break;
+            }
+        }
+        if (!blocked) {
+            best = &candidate;
+        }
+    }
+    return best;
+}
+
+void I2CBus::start(Slot& slot, uint64_t now)
+{
+    auto& t = slot.transaction;
+    if (slot.phase == Phase::Wait) {
+        slot.phase = Phase::Read;
+    }
+    if (slot.phase == Phase::Write || t.txLen == 0) {
+        stats_.queuedUs += now - slot.submitted;
+    }
+    active_ = &slot;
+    phaseStart_ = now;
+
+#ifdef SCD_EMULATOR
+    auto& emulator = ScdEmulator::instance(index_);
+    emulatedResult_ = slot.phase == Phase::Write ? emulator.write(t.address, t.tx, t.txLen)
+                                                 : emulator.read(t.address, t.rx, t.rxLen);
+#else
+    auto hw = i2c_get_hw(i2c_);
+    hw->enable = 0;
+    hw->tar = t.address;
+    hw->enable = 1;
+    (void)hw->clr_tx_abrt;
+    (void)hw->clr_stop_det;
+
+    uint16_t count = slot.phase == Phase::Write ? t.txLen : t.rxLen;
+    for (uint16_t i = 0; i < count; ++i) {
+        uint16_t command = slot.phase == Phase::Write ? t.tx[i] : I2C_IC_DATA_CMD_CMD_BITS;
+        if (i + 1 == count) {
+            command |= I2C_IC_DATA_CMD_STOP_BITS;
+        }
+        commands_[i] = command;
+    }
+
+    if (slot.phase == Phase::Read) {
+        auto config = dma_channel_get_default_config(rxChannel_);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+        channel_config_set_read_increment(&config, false);
+        channel_config_set_write_increment(&config, true);
+        channel_config_set_dreq(&config, i2c_get_dreq(i2c_, false));
+        dma_channel_configure(rxChannel_, &config, t.rx, &hw->data_cmd, count, true);
+    }
+    // Read commands are clocked out like data, each one makes the controller receive a byte
+    auto config = dma_channel_get_default_config(txChannel_);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, i2c_get_dreq(i2c_, true));
+    dma_channel_configure(txChannel_, &config, &hw->data_cmd, commands_.data(), count, true);
+#endif
+}
+
+int I2CBus::poll(uint64_t now)
+{
+#ifdef SCD_EMULATOR
+    return emulatedResult_;
+#else
+    auto hw = i2c_get_hw(i2c_);
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        // Mostly an address or data NACK, the controller has flushed its FIFO and sent a STOP
+        abort();
+        return nackError;
+    }
+    bool stopped = hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_STOP_DET_BITS;
+    if (stopped && !dma_channel_is_busy(txChannel_) &&
+        (active_->phase != Phase::Read || !dma_channel_is_busy(rxChannel_))) {
+        (void)hw->clr_stop_det;
+        return 0;
+    }
+    if (now - phaseStart_ > phaseTimeoutUs) {
+        abort();
+        return timeoutError;
+    }
+    return pending;
+#endif
+}
+
+void I2CBus::abort()
+{
+#ifndef SCD_EMULATOR
+    dma_channel_abort(txChannel_);
+    dma_channel_abort(rxChannel_);
+    auto hw = i2c_get_hw(i2c_);
+    (void)hw->clr_tx_abrt;
+    (void)hw->clr_stop_det;
+    // Disabling the controller drops whatever is left in its FIFOs
+    hw->enable = 0;
+#endif
+}
+
+void I2CBus::finish(Slot& slot, int result)
+{
+    ++stats_.transactions;
+    if (result == nackError) {
+        ++stats_.nacks;
+    } else if (result == timeoutError) {
+        ++stats_.timeouts;
+    }
+    auto transaction = slot.transaction;
+    slot.phase = Phase::Free;
+    if (transaction.done) {
+        transaction.done(transaction.arg, result);
+    }
+}
+
+void I2CBus::printStats() const
+{
+    auto elapsed = time_us_64() - stats_.since;
+    const auto& s = stats_;
+    std::cout << "I2C bus " << index_ << ": " << s.transactions << " transactions, utilization "
+              << (elapsed ? 100.0f * s.busyUs / elapsed : 0) << "%, " << s.nacks << " NACKs, " << s.timeouts
+              << " timeouts, " << s.rejected << " rejected, avg queued "
+              << (s.transactions ? s.queuedUs / s.transactions : 0) << " us, max queue " << s.maxQueued << "\n";
+}
+} // namespace weather_station
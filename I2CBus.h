@@ -0,0 +1,114 @@
+#pragma once
+
+#include <hardware/i2c.h>
+
+#include <array>
+#include <cstdint>
+
+namespace weather_station
+{
+// Shared I2C bus for all sensor drivers. Transactions are queued and run one at a time with DMA feeding the
+// controller, process() from the main loop starts them and calls their completion callback, so a transfer costs the
+// loop a few register accesses instead of the whole bus time. A transaction is a write, an optional wait for the
+// device to execute the command and an optional read. The bus is free for other devices during the wait, and the
+// transactions of one device never overtake each other.
+class I2CBus
+{
+public:
+    // result is 0 on success, nackError if the device did not acknowledge or timeoutError
+    using Callback = void (*)(void* arg, int result);
+
+    struct Transaction
+    {
+        uint8_t address = 0;
+        const uint8_t* tx = nullptr;
+        uint16_t txLen = 0;
+        uint8_t* rx = nullptr;
+        uint16_t rxLen = 0;
+        // Between the end of the write and the read, e.g. the SCD4x command execution time
+        uint32_t delayUs = 0;
+        Callback done = nullptr;
+        void* arg = nullptr;
+    };
+
+    // What the Sensirion drivers see for a NACK, SCD::process() restarts the sensor on it
+    static constexpr int nackError = -123;
+    static constexpr int timeoutError = -124;
+    static constexpr uint16_t maxTransfer = 32;
+
+    static constexpr unsigned busCount = 2;
+
+    // i2c0 or i2c1 on the pins from the topology, set up on first use
+    static I2CBus& bus(unsigned index);
+    // process() of every bus in use
+    static void processAll();
+    // busy() of any bus in use
+    static bool anyBusy();
+    static void printAllStats();
+
+    I2CBus(unsigned index, unsigned baudrate);
+    I2CBus(const I2CBus&) = delete;
+    I2CBus& operator=(const I2CBus&) = delete;
+
+    // False if the queue is full or a transfer is longer than maxTransfer
+    bool submit(const Transaction& transaction);
+    // Submits and runs the bus until the transaction is done, for drivers that can only block
+    int transfer(const Transaction& transaction);
+    void process();
+
+    // A transaction is queued, on the bus or waiting for its device. Changing clk_sys now would break it, the baudrate
+    // can only be reprogrammed with the controller disabled.
+    bool busy() const;
+    // The divider has to follow clk_sys changes
+    void clockChanged();
+    // Share of time the bus was transferring, transactions, errors and queueing delay
+    void printStats() const;
+
+private:
+    enum class Phase : uint8_t { Free, Write, Wait, Read };
+
+    struct Slot
+    {
+        Transaction transaction;
+        Phase phase = Phase::Free;
+        uint32_t order = 0;
+        uint64_t submitted = 0;
+        uint64_t notBefore = 0;
+    };
+
+    Slot* next(uint64_t now);
+    void start(Slot& slot, uint64_t now);
+    // Positive while the active phase is still running
+    int poll(uint64_t now);
+    void finish(Slot& slot, int result);
+    void abort();
+
+    const unsigned index_;
+    i2c_inst_t* const i2c_;
+    const unsigned baudrate_;
+    int txChannel_ = -1;
+    int rxChannel_ = -1;
+    std::array<Slot, 8> slots_;
+    Slot* active_ = nullptr;
+    uint64_t phaseStart_ = 0;
+    uint32_t nextOrder_ = 0;
+    std::array<uint16_t, maxTransfer> commands_;
+    // With the SCD emulator in place of the controller every phase completes right away
+    int emulatedResult_ = 0;
+
+    struct Stats
+    {
+        uint64_t since = 0;
+        uint64_t busyUs = 0;
+        uint32_t transactions = 0;
+        uint32_t nacks = 0;
+        uint32_t timeouts = 0;
+        uint32_t rejected = 0;
+        uint64_t queuedUs = 0;
+        uint32_t maxQueued = 0;
+    };
+    Stats stats_;
+
+    static constexpr uint64_t phaseTimeoutUs = 10000;
+};
+} // namespace weather_station
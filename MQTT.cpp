@@ -1,173 +1,505 @@
 #include "MQTT.h"
+#include "DerivedMetrics.h"
+#include "Network.h"
+#include "Trace.h"
+#include "FaultInjector.h"
 
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
-#include "pico/unique_id.h"
 
 #include "lwip/dns.h"
+#include "lwip/timeouts.h"
+#ifdef MQTT_TLS
+#include "lwip/altcp_tls.h"
+#include "mbedtls/ssl.h"
+#ifdef MQTT_TLS_CA
+#include "mqtt_ca.h"
+#endif
+#endif
+
+#include <malloc.h>
 
 #include <iostream>
 #include <sstream>
-#include <iomanip>
 #include <algorithm>
-#include <cctype>
 
 constexpr std::string_view MQTT_TOPIC_CO2 = "home/weather_station/co2\0";
 
+#ifdef MQTT_SOAK
+#ifndef MQTT_SOAK_DELAY_MS
+#define MQTT_SOAK_DELAY_MS 0
+#endif
+#ifndef MQTT_SOAK_LOSS_PERCENT
+#define MQTT_SOAK_LOSS_PERCENT 0
+#endif
+#endif
+
 namespace weather_station
 {
 MQTT::MQTT()
 {
-    if (cyw43_arch_init() != 0) {
-        std::cout << "cyw43 init failed!\n";
+    if (!Network::init()) {
         return;
     }
-    cyw43_arch_enable_sta_mode();
     memset(&mqttClientInfo_, 0, sizeof(mqttClientInfo_));
 
-    char unique_buf[4] = {0};
-    pico_get_unique_board_id_string(unique_buf, sizeof(unique_buf));
-    clientId_ = std::string("pico") + unique_buf;
-    std::transform(clientId_.begin(), clientId_.end(), clientId_.begin(), [](unsigned char c) {
-        return std::tolower(c);
-    });
+    clientId_ = Network::stationId();
     std::cout << "MQTT Client ID: " << clientId_ << "\n";
     mqttClientInfo_.client_id = clientId_.c_str();
     mqttClientInfo_.client_user = MQTT_USERNAME;
     mqttClientInfo_.client_pass = MQTT_PASSWORD;
     mqttClientInfo_.keep_alive = 60;
+#ifdef MQTT_TLS
+    // Created once: parsing the CA and seeding the DRBG is not repeated on reconnects
+#ifdef MQTT_TLS_CA
+    mqttClientInfo_.tls_config =
+        altcp_tls_create_config_client(reinterpret_cast<const u8_t*>(mqttCaCert), sizeof(mqttCaCert));
+#else
+    std::cout << "MQTT TLS without a CA, the broker is not verified\n";
+    mqttClientInfo_.tls_config = altcp_tls_create_config_client(nullptr, 0);
+#endif
+    altcp_tls_init_session(&session_);
+#endif
+    commandTopic_ = "home/weather_station/" + clientId_ + "/cmd";
+    ackTopic_ = "home/weather_station/" + clientId_ + "/ack";
 }
 
 MQTT::~MQTT()
 {
     std::cout << "Closing MQTT client\n";
-    cyw43_arch_deinit();
+    Network::deinit();
 }
 
 bool MQTT::Connect()
 {
-    // allow the firmware/state machine a short moment after enabling STA mode
-    sleep_ms(2000);
-
-    int connectCount = 0;
-    int rc = 0;
-    do {
-        rc = cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000);
-        if (rc != 0) {
-            std::cerr << "failed to connect (code " << rc << ").\n";
-            connectCount++;
-            if (connectCount >= 3) {
-                panic("Failed to connect to WiFi");
-            }
-            std::cout << "Retrying in 5 seconds...\n";
-            sleep_ms(5000);
-        }
-    } while (rc != 0);
-    std::cout << "Connected.\n";
+    startedAt_ = time_us_64();
+    if (!Network::connect()) {
+        std::cerr << "Failed to connect to WiFi, retrying in the background\n";
+        scheduleReconnect();
+        return false;
+    }
+    resolve();
+    return true;
+}
 
+void MQTT::resolve()
+{
     cyw43_arch_lwip_begin();
-    auto err = dns_gethostbyname(MQTT_SERVER, &mqttServer_, MQTT::dnsFoundCallback, this);
+    err_t err = FaultInjector::fail(FaultInjector::Fault::DnsFailure)
+                   ? static_cast<err_t>(ERR_TIMEOUT)
+                   : dns_gethostbyname(MQTT_SERVER, &mqttServer_, MQTT::dnsFoundCallback, this);
     cyw43_arch_lwip_end();
     if (err == ERR_INPROGRESS) {
         std::cout << "DNS request in progress...\n";
-    } else if (err != ERR_OK) {
-        panic("DNS request failed");
+    } else if (err == ERR_OK) {
+        // Answered from the DNS cache, the callback is not going to be called
+        resolved_ = true;
+        startClient();
+    } else {
+        std::cerr << "DNS request failed: " << err << "\n";
+        scheduleReconnect();
     }
-
-    return true;
 }
 
 void MQTT::dnsFound(const ip_addr_t* ipaddr)
 {
+    Trace::Scope scope(Trace::Point::MqttDns);
     if (ipaddr) {
         std::cout << "DNS resolved MQTT server to " << ipaddr_ntoa(ipaddr) << "\n";
         mqttServer_ = *ipaddr;
+        resolved_ = true;
         startClient();
     } else {
-        panic("dns request failed");
+        std::cerr << "DNS request failed\n";
+        scheduleReconnect();
     }
 }
 
+void MQTT::scheduleReconnect()
+{
+    if (suspended_) {
+        return;
+    }
+    std::cout << "MQTT reconnecting in " << reconnectDelay_ << " ms\n";
+    cyw43_arch_lwip_begin();
+    sys_untimeout(MQTT::reconnectCallback, this);
+    sys_timeout(reconnectDelay_, MQTT::reconnectCallback, this);
+    cyw43_arch_lwip_end();
+    // Back off while the broker or the network stays away, so a whole site does not hammer it at once
+    reconnectDelay_ = std::min(reconnectDelay_ * 2, maxReconnectDelay);
+}
+
 void MQTT::startClient()
 {
+#ifdef MQTT_TLS
+    constexpr int port = 8883;
+#else
     constexpr int port = 1883;
+#endif
     std::cout << "Starting MQTT client to " << ipaddr_ntoa(&mqttServer_) << ":" << port << "\n";
-    mqttClient_ = mqtt_client_new();
     if (!mqttClient_) {
-        panic("Failed to create MQTT client instance");
+        mqttClient_ = mqtt_client_new();
     }
+    if (!mqttClient_) {
+        std::cerr << "Failed to create MQTT client instance\n";
+        scheduleReconnect();
+        return;
+    }
+    connectStart_ = time_us_64();
+    heapBeforeConnect_ = mallinfo().uordblks;
     cyw43_arch_lwip_begin();
-    if (mqtt_client_connect(mqttClient_, &mqttServer_, port, MQTT::mqttConnectionCallback, this, &mqttClientInfo_) !=
-        ERR_OK) {
-        panic("MQTT broker connection error");
+    auto err =
+        mqtt_client_connect(mqttClient_, &mqttServer_, port, MQTT::mqttConnectionCallback, this, &mqttClientInfo_);
+    if (err != ERR_OK) {
+        cyw43_arch_lwip_end();
+        std::cerr << "MQTT broker connection error: " << err << "\n";
+        scheduleReconnect();
+        return;
+    }
+#ifdef MQTT_TLS
+    // The handshake starts once TCP is connected, there is still time to offer the session of the last connection
+    auto ssl = static_cast<mbedtls_ssl_context*>(altcp_tls_context(mqttClient_->conn));
+    mbedtls_ssl_set_hostname(ssl, MQTT_SERVER);
+    if (haveSession_) {
+        altcp_tls_set_session(mqttClient_->conn, &session_);
     }
+#endif
     mqtt_set_inpub_callback(mqttClient_, MQTT::mqttIncomingPublishCallback, MQTT::mqttIncomingDataCallback, this);
     cyw43_arch_lwip_end();
 }
 
+void MQTT::reconnect()
+{
+    if (suspended_ || connected_) {
+        return;
+    }
+    if (!Network::linkUp()) {
+        std::cout << "MQTT waiting for WiFi\n";
+        Network::rejoin();
+        scheduleReconnect();
+    } else if (!resolved_) {
+        resolve();
+    } else {
+        startClient();
+    }
+}
+
+void MQTT::Disconnect()
+{
+    suspended_ = true;
+    cyw43_arch_lwip_begin();
+    sys_untimeout(MQTT::reconnectCallback, this);
+    if (mqttClient_) {
+        // No connection callback for a disconnect we asked for
+        mqtt_disconnect(mqttClient_);
+    }
+    cyw43_arch_lwip_end();
+    connected_ = false;
+    abandonReport();
+}
+
+void MQTT::Reconnect()
+{
+    suspended_ = false;
+    reconnectDelay_ = minReconnectDelay;
+    if (!connected_) {
+        reconnect();
+    }
+}
+
+void MQTT::DropConnection(bool forgetServer)
+{
+    if (forgetServer) {
+        resolved_ = false;
+    }
+    cyw43_arch_lwip_begin();
+    if (connected_ && mqttClient_ && mqttClient_->conn) {
+        // The error callback closes the client and reports MQTT_CONNECT_DISCONNECTED like a real link loss
+        altcp_abort(mqttClient_->conn);
+    }
+    cyw43_arch_lwip_end();
+}
+
+void MQTT::PrintHealth() const
+{
+    const auto& h = health_;
+    auto minutes = (time_us_64() - startedAt_) / 60e6f;
+    std::cout << "MQTT health: " << h.published << " published, " << h.failed << " failed";
+    if (minutes > 0) {
+        std::cout << ", " << h.published / minutes << " msg/min, " << h.bytes / minutes << " bytes/min";
+    }
+    std::cout << "; latency p50 " << h.latencyUs.percentile(50) / 1000 << " ms, p90 " << h.latencyUs.percentile(90) / 1000
+              << " ms, p99 " << h.latencyUs.percentile(99) / 1000 << " ms, max " << h.latencyUs.max() / 1000
+              << " ms; " << h.disconnects << " disconnects, recovery avg " << h.recoveryMs.mean() << " ms, max "
+              << h.recoveryMs.max() << " ms; heap in use " << mallinfo().uordblks << " bytes\n";
+#ifdef MQTT_SOAK
+    std::cout << "MQTT soak: " << MQTT_SOAK_DELAY_MS << " ms delay, " << MQTT_SOAK_LOSS_PERCENT << " % loss, "
+              << soakLost_ << " publishes lost\n";
+#endif
+}
+
+void MQTT::PrintConnectStats() const
+{
+    const auto& s = connectStats_;
+    if (s.connects == 0) {
+        return;
+    }
+    std::cout << "MQTT connect: " << s.connects << " connects (" << s.resumed << " resumed), last " << s.lastUs / 1000
+              << " ms, max " << s.maxUs / 1000 << " ms, avg " << s.totalUs / s.connects / 1000 << " ms, heap +"
+              << s.heapGrowth << " bytes, arena " << s.heapArena << " bytes\n";
+}
+
 void MQTT::onConnection(mqtt_client_t* client, mqtt_connection_status_t status)
 {
+    Trace::Scope scope(Trace::Point::MqttConnection, status);
     if (status == MQTT_CONNECT_ACCEPTED) {
         connected_ = true;
+        reconnectDelay_ = minReconnectDelay;
+        if (disconnectedAt_ != 0) {
+            health_.recoveryMs.add((time_us_64() - disconnectedAt_) / 1000.0f);
+            disconnectedAt_ = 0;
+        }
+        recordConnect();
         std::cout << "MQTT connected\n";
         if (reportingState_ == ReportingState::Pending) {
             reportCO2();
         }
-        // mqtt_sub_unsub(mqttClient_, "home/weather_station/co2", 1, MQTT::mqttSubscribeCallback, this, true);
-        // mqtt_sub_unsub(mqttClient_, "home/weather_station/temperature", 1, MQTT::mqttSubscribeCallback, this, true);
-        // mqtt_sub_unsub(mqttClient_, "home/weather_station/humidity", 1, MQTT::mqttSubscribeCallback, this, true);
-    } else if (status == MQTT_CONNECT_DISCONNECTED) {
-        std::cout << "MQTT disconnected\n";
-        if (!connected_) {
-            panic("Failed to connect to mqtt server");
-        }
+        mqtt_sub_unsub(mqttClient_, "home/weather_station/cmd", 1, MQTT::mqttSubscribeCallback, this, true);
+        mqtt_sub_unsub(mqttClient_, commandTopic_.c_str(), 1, MQTT::mqttSubscribeCallback, this, true);
     } else {
-        std::cout << "MQTT connection failed with status: " << status << "\n";
-        panic("Unexpected status");
+        std::cout << "MQTT connection lost or refused, status: " << status << "\n";
+        if (connected_) {
+            ++health_.disconnects;
+            disconnectedAt_ = time_us_64();
+        }
+        connected_ = false;
+        abandonReport();
+        scheduleReconnect();
     }
 }
 
+void MQTT::recordConnect()
+{
+    auto& s = connectStats_;
+    auto elapsed = time_us_64() - connectStart_;
+    ++s.connects;
+    s.lastUs = elapsed;
+    s.maxUs = std::max(s.maxUs, elapsed);
+    s.totalUs += elapsed;
+    // newlib never gives memory back to the arena, so its size is the high-water mark of the heap
+    auto info = mallinfo();
+    s.heapGrowth = info.uordblks - heapBeforeConnect_;
+    s.heapArena = info.arena;
+#ifdef MQTT_TLS
+    auto ssl = static_cast<mbedtls_ssl_context*>(altcp_tls_context(mqttClient_->conn));
+    // The server echoes the offered session id only when it resumes it
+    const auto* current = mbedtls_ssl_get_session_pointer(ssl);
+    if (haveSession_ && current && current->id_len != 0 && current->id_len == session_.data.id_len &&
+        memcmp(current->id, session_.data.id, current->id_len) == 0) {
+        ++s.resumed;
+    }
+    if (haveSession_) {
+        altcp_tls_free_session(&session_);
+        altcp_tls_init_session(&session_);
+    }
+    haveSession_ = altcp_tls_get_session(mqttClient_->conn, &session_) == ERR_OK;
+#endif
+    std::cout << "MQTT connected in " << elapsed / 1000 << " ms\n";
+}
+
 void MQTT::onSubscribe(err_t err)
 {
     if (err != ERR_OK) {
-        panic("Subscribe failed");
+        // Reporting keeps working, the station just can't be retuned until the next connection
+        std::cerr << "Subscribe failed: " << err << "\n";
     }
 }
 
 void MQTT::onIncomingPublish(const char* topic, u32_t tot_len)
 {
+    Trace::instant(Trace::Point::MqttIncoming, tot_len);
     std::cout << "Incoming publish on topic: " << topic << " len=" << tot_len << "\n";
+    std::string_view name{topic};
+    receivingCommand_ = (name == "home/weather_station/cmd" || name == commandTopic_) && tot_len <= maxCommandSize;
+    incoming_.clear();
 }
 
 void MQTT::onIncomingData(const u8_t* data, u16_t len, u8_t flags)
 {
-    std::cout << "Incoming data len=" << len << " flags=" << (int)flags << ": "
-              << std::string_view{(const char*)data, len} << "\n";
+    Trace::Scope scope(Trace::Point::MqttIncoming, len);
+    if (!receivingCommand_) {
+        return;
+    }
+    incoming_.append(reinterpret_cast<const char*>(data), len);
+    if (!(flags & MQTT_DATA_FLAG_LAST)) {
+        return;
+    }
+    receivingCommand_ = false;
+    if (commands_.size() >= maxPendingCommands) {
+        std::cerr << "Too many pending commands, dropping: " << incoming_ << "\n";
+        return;
+    }
+    // Runs in the lwIP context, the main loop applies it
+    commands_.push_back(std::move(incoming_));
+    incoming_.clear();
 }
 
-void MQTT::ReportWeather(int co2, float temp, float hum)
+bool MQTT::TakeCommand(std::string& command)
+{
+    cyw43_arch_lwip_begin();
+    bool available = !commands_.empty();
+    if (available) {
+        command = std::move(commands_.front());
+        commands_.pop_front();
+    }
+    cyw43_arch_lwip_end();
+    return available;
+}
+
+void MQTT::Acknowledge(const std::string& response)
 {
-    co2_ = co2;
-    temp_ = temp;
-    hum_ = hum;
     if (!connected_) {
-        reportingState_ = ReportingState::Pending;
-        std::cout << "MQTT client not started yet, Enqueueing report\n";
         return;
     }
-    if (reportingState_ != ReportingState::Idle) {
+    cyw43_arch_lwip_begin();
+    auto err = mqtt_publish(mqttClient_, ackTopic_.c_str(), response.c_str(), response.size(), qos_, 0, nullptr, nullptr);
+    cyw43_arch_lwip_end();
+    if (err != ERR_OK) {
+        std::cerr << "Failed to publish command ack: " << err << "\n";
+    }
+}
+
+bool MQTT::ReportWeather(
+    const Sensor::Measurement& measurement, const WindowStats& stats, uint64_t timestamp, uint32_t sequence,
+    std::vector<SensorReading> sensors
+)
+{
+    if (!Accepting()) {
         std::cout << "Already publishing, skipping\n";
-        return;
+        return false;
+    }
+    measurement_ = measurement;
+    stats_ = stats;
+    timestamp_ = timestamp;
+    sensors_ = std::move(sensors);
+    sensorIndex_ = 0;
+    if (!connected_) {
+        firstSequence_ = lastSequence_ = sequence;
+        reportFailed_ = false;
+        reportingState_ = ReportingState::Pending;
+        std::cout << "MQTT client not started yet, Enqueueing report\n";
+        return true;
     }
     std::cout << "Starting weather report\n";
+    ++exportStats_.samples;
+    firstSequence_ = lastSequence_ = sequence;
+    reportFailed_ = false;
     reportCO2();
+    return true;
+}
+
+err_t MQTT::publish(const char* topic, const std::string& payload, uint64_t start)
+{
+    cyw43_arch_lwip_begin();
+    err_t err = FaultInjector::fail(FaultInjector::Fault::PbufExhaustion)
+                   ? static_cast<err_t>(ERR_MEM)
+                   : mqtt_publish(
+                         mqttClient_, topic, payload.c_str(), payload.size(), qos_, 0,
+                         MQTT::mqttPublishRequestCallback, this
+                     );
+    cyw43_arch_lwip_end();
+    exportStats_.cpuUs += time_us_64() - start;
+    if (err == ERR_OK) {
+        publishedAt_ = time_us_64();
+        health_.bytes += payload.size();
+        // PUBLISH out, plus PUBACK in and our TCP ACK for it above QoS 0. Fixed header, topic length and packet id on
+        // top of the payload.
+        int frames = qos_ > 0 ? 2 : 1;
+        exportStats_.frames += frames;
+        exportStats_.airBytes += 2 + 2 + strlen(topic) + (qos_ > 0 ? 2 : 0) + payload.size() +
+                                 frames * ExportStats::tcpFrameOverhead;
+    }
+    return err;
+}
+
+void MQTT::ReportBacklog(std::string payload, uint32_t first, uint32_t last)
+{
+    if (!Ready()) {
+        return;
+    }
+    backlog_ = std::move(payload);
+    firstSequence_ = first;
+    lastSequence_ = last;
+    reportFailed_ = false;
+    reportBacklog();
+}
+
+void MQTT::ReportPeers(std::string payload)
+{
+    if (!Ready()) {
+        return;
+    }
+    backlog_ = std::move(payload);
+    firstSequence_ = lastSequence_ = 0;
+    reportFailed_ = false;
+    reportPeers();
+}
+
+void MQTT::abandonReport()
+{
+    // lwIP drops the outstanding requests of a closed connection without calling back, the flash log replays what
+    // was lost
+    if (reportingState_ != ReportingState::Idle && reportingState_ != ReportingState::Pending) {
+        reportingState_ = ReportingState::Idle;
+        lastSequence_ = 0;
+    }
+#ifdef MQTT_SOAK
+    // The same for a publish the soak test is holding back
+    cyw43_arch_lwip_begin();
+    sys_untimeout(MQTT::soakReleaseCallback, this);
+    cyw43_arch_lwip_end();
+#endif
+}
+
+void MQTT::finishReport()
+{
+    reportingState_ = ReportingState::Idle;
+    if (!reportFailed_ && lastSequence_ != 0 && onDelivered_) {
+        onDelivered_(firstSequence_, lastSequence_);
+    }
+    lastSequence_ = 0;
+}
+
+#ifdef MQTT_SOAK
+void MQTT::soakPublish(err_t err)
+{
+    // A PUBLISH or PUBACK lost on the way surfaces as the request timing out
+    soakSeed_ = soakSeed_ * 1664525 + 1013904223;
+    if (err == ERR_OK && (soakSeed_ >> 8) % 100 < MQTT_SOAK_LOSS_PERCENT) {
+        err = ERR_TIMEOUT;
+        ++soakLost_;
+    }
+    if (MQTT_SOAK_DELAY_MS == 0) {
+        onPublish(err);
+        return;
+    }
+    // Reports publish one message at a time, so there is at most one held back
+    soakResult_ = err;
+    sys_timeout(MQTT_SOAK_DELAY_MS, MQTT::soakReleaseCallback, this);
 }
+#endif
 
 void MQTT::onPublish(err_t err)
 {
+    Trace::Scope scope(Trace::Point::MqttPublish, static_cast<uint32_t>(err));
     if (err != ERR_OK) {
         std::cerr << "Publish failed: " << err << "\n";
+        ++health_.failed;
+        reportFailed_ = true;
     } else {
+        // Until PUBACK for QoS 1 and 2, until the segment was sent for QoS 0
+        health_.latencyUs.add(time_us_64() - publishedAt_);
+        ++health_.published;
         std::cout << "Publish successful\n";
     }
     switch (reportingState_) {
@@ -178,7 +510,22 @@ void MQTT::onPublish(err_t err)
             reportHumidity();
             break;
         case ReportingState::ReportingHumidity:
-            reportingState_ = ReportingState::Idle;
+            reportDerived();
+            break;
+        case ReportingState::ReportingDerived:
+            reportStats();
+            break;
+        case ReportingState::ReportingStats:
+        case ReportingState::ReportingSensors:
+            if (sensorIndex_ < sensors_.size()) {
+                reportSensor();
+            } else {
+                finishReport();
+            }
+            break;
+        case ReportingState::ReportingBacklog:
+        case ReportingState::ReportingPeers:
+            finishReport();
             break;
         default:
             break;
@@ -187,19 +534,15 @@ void MQTT::onPublish(err_t err)
 
 void MQTT::reportCO2()
 {
+    auto start = time_us_64();
     std::stringstream ss;
-    ss << co2_;
+    ss << measurement_.CO2;
     std::string co2_str = ss.str();
 
     std::cout << "Reporting CO2: " << co2_str << "\n";
     reportingState_ = ReportingState::ReportingCO2;
 
-    cyw43_arch_lwip_begin();
-    auto err = mqtt_publish(
-        mqttClient_, "home/weather_station/co2", co2_str.c_str(), co2_str.size(), 1, 0,
-        MQTT::mqttPublishRequestCallback, this
-    );
-    cyw43_arch_lwip_end();
+    auto err = publish("home/weather_station/co2", co2_str, start);
     if (err != ERR_OK) {
         std::cerr << "Failed to publish CO2: " << err << "\n";
         reportingState_ = ReportingState::Idle;
@@ -208,19 +551,15 @@ void MQTT::reportCO2()
 
 void MQTT::reportTemperature()
 {
+    auto start = time_us_64();
     std::stringstream ss;
-    ss << std::fixed << std::setprecision(2) << temp_;
+    writeCenti(ss, measurement_.Temperature);
     std::string temp_str = ss.str();
 
     std::cout << "Reporting Temperature: " << temp_str << "\n";
     reportingState_ = ReportingState::ReportingTemperature;
 
-    cyw43_arch_lwip_begin();
-    auto err = mqtt_publish(
-        mqttClient_, "home/weather_station/temperature", temp_str.c_str(), temp_str.size(), 1, 0,
-        MQTT::mqttPublishRequestCallback, this
-    );
-    cyw43_arch_lwip_end();
+    auto err = publish("home/weather_station/temperature", temp_str, start);
     if (err != ERR_OK) {
         std::cerr << "Failed to publish Temperature: " << err << "\n";
         reportingState_ = ReportingState::Idle;
@@ -229,22 +568,166 @@ void MQTT::reportTemperature()
 
 void MQTT::reportHumidity()
 {
+    auto start = time_us_64();
     std::stringstream ss;
-    ss << std::fixed << std::setprecision(2) << hum_;
+    writeCenti(ss, measurement_.Humidity);
     std::string hum_str = ss.str();
 
     std::cout << "Reporting Humidity: " << hum_str << "\n";
     reportingState_ = ReportingState::ReportingHumidity;
 
-    cyw43_arch_lwip_begin();
-    auto err = mqtt_publish(
-        mqttClient_, "home/weather_station/humidity", hum_str.c_str(), hum_str.size(), 1, 0,
-        MQTT::mqttPublishRequestCallback, this
-    );
-    cyw43_arch_lwip_end();
+    auto err = publish("home/weather_station/humidity", hum_str, start);
     if (err != ERR_OK) {
         std::cerr << "Failed to publish Humidity: " << err << "\n";
         reportingState_ = ReportingState::Idle;
     }
 }
+
+namespace
+{
+void writeDerived(std::ostream& os, const Sensor::Measurement& measurement)
+{
+    auto derived = DerivedMetrics::compute(measurement.Temperature, measurement.Humidity);
+    os << "\"dew_point\":";
+    writeCenti(os, derived.dewPoint);
+    os << ",\"absolute_humidity\":";
+    writeCenti(os, derived.absoluteHumidity);
+    os << ",\"heat_index\":";
+    writeCenti(os, derived.heatIndex);
+}
+
+// centi tells whether the samples are in centi-units or whole ones like the CO2 ppm
+void writeStats(std::ostream& os, std::string_view name, const SampleStats& stats, bool centi)
+{
+    auto write = [&](int32_t value) -> std::ostream& {
+        if (centi) {
+            writeCenti(os, value);
+        } else {
+            os << value;
+        }
+        return os;
+    };
+    os << '"' << name << "\":{\"n\":" << stats.count() << ",\"min\":";
+    write(stats.min()) << ",\"max\":";
+    write(stats.max()) << ",\"mean\":";
+    write(stats.mean()) << ",\"sd\":";
+    write(stats.stddev()) << ",\"last\":";
+    write(stats.last()) << "}";
+}
+} // namespace
+
+std::string MQTT::FormatDerived(const Sensor::Measurement& measurement)
+{
+    std::stringstream ss;
+    ss << "{";
+    writeDerived(ss, measurement);
+    ss << "}";
+    return ss.str();
+}
+
+void MQTT::reportDerived()
+{
+    auto start = time_us_64();
+    std::string derived_str = FormatDerived(measurement_);
+
+    std::cout << "Reporting Derived: " << derived_str << "\n";
+    reportingState_ = ReportingState::ReportingDerived;
+
+    auto err = publish("home/weather_station/derived", derived_str, start);
+    if (err != ERR_OK) {
+        std::cerr << "Failed to publish Derived: " << err << "\n";
+        reportingState_ = ReportingState::Idle;
+    }
+}
+
+std::string MQTT::FormatStats(const WindowStats& stats, uint64_t timestamp)
+{
+    std::stringstream ss;
+    ss << "{";
+    if (timestamp != 0) {
+        // Milliseconds since the epoch, when the reported sample was taken
+        ss << "\"time\":" << timestamp / 1000 << ",";
+    }
+    writeStats(ss, "co2", stats.CO2, false);
+    ss << ",";
+    writeStats(ss, "temperature", stats.Temperature, true);
+    ss << ",";
+    writeStats(ss, "humidity", stats.Humidity, true);
+    ss << ",\"rejected\":" << stats.rejected << "}";
+    return ss.str();
+}
+
+void MQTT::reportStats()
+{
+    auto start = time_us_64();
+    std::string stats_str = FormatStats(stats_, timestamp_);
+
+    std::cout << "Reporting Stats: " << stats_str << "\n";
+    reportingState_ = ReportingState::ReportingStats;
+
+    auto err = publish("home/weather_station/stats", stats_str, start);
+    if (err != ERR_OK) {
+        std::cerr << "Failed to publish Stats: " << err << "\n";
+        reportingState_ = ReportingState::Idle;
+    }
+}
+
+std::string MQTT::FormatSensor(const Sensor::Measurement& measurement)
+{
+    std::stringstream ss;
+    ss << "{\"temperature\":";
+    writeCenti(ss, measurement.Temperature);
+    ss << ",\"humidity\":";
+    writeCenti(ss, measurement.Humidity);
+    if (measurement.has(Sensor::Measurement::HasCO2)) {
+        ss << ",\"co2\":" << measurement.CO2;
+    }
+    ss << ",";
+    writeDerived(ss, measurement);
+    ss << "}";
+    return ss.str();
+}
+
+void MQTT::reportSensor()
+{
+    auto start = time_us_64();
+    const auto& sensor = sensors_[sensorIndex_++];
+    std::string topic = std::string("home/weather_station/sensors/") + sensor.id;
+    std::string payload = FormatSensor(sensor.measurement);
+
+    std::cout << "Reporting " << topic << ": " << payload << "\n";
+    reportingState_ = ReportingState::ReportingSensors;
+
+    auto err = publish(topic.c_str(), payload, start);
+    if (err != ERR_OK) {
+        std::cerr << "Failed to publish sensor " << sensor.id << ": " << err << "\n";
+        reportingState_ = ReportingState::Idle;
+    }
+}
+
+void MQTT::reportBacklog()
+{
+    auto start = time_us_64();
+    std::cout << "Reporting backlog " << firstSequence_ << ".." << lastSequence_ << "\n";
+    reportingState_ = ReportingState::ReportingBacklog;
+
+    auto err = publish("home/weather_station/backlog", backlog_, start);
+    if (err != ERR_OK) {
+        std::cerr << "Failed to publish Backlog: " << err << "\n";
+        reportingState_ = ReportingState::Idle;
+    }
+}
+
+void MQTT::reportPeers()
+{
+    auto start = time_us_64();
+    std::cout << "Forwarding peer readings\n";
+    reportingState_ = ReportingState::ReportingPeers;
+
+    auto err = publish("home/weather_station/peers", backlog_, start);
+    if (err != ERR_OK) {
+        std::cerr << "Failed to publish Peers: " << err << "\n";
+        reportingState_ = ReportingState::Idle;
+    }
+}
 } // namespace weather_station
\ No newline at end of file
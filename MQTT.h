@@ -5,7 +5,18 @@
 
 #include "lwip/apps/mqtt.h"
 #include "lwip/apps/mqtt_priv.h"
+#ifdef MQTT_TLS
+#include "lwip/altcp_tls.h"
+#endif
+
+#include "Statistics.h"
+#include "ExportStats.h"
+#include "Sensor.h"
+
+#include <deque>
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace weather_station
 {
@@ -16,8 +27,64 @@ public:
     ~MQTT();
 
     bool Connect();
+    // Closes the connection without reconnecting, e.g. before the radio is switched off
+    void Disconnect();
+    // Connects again after Disconnect(), the network must be up
+    void Reconnect();
+
+    // timestamp is UTC microseconds (0 if unknown), sequence identifies the report in the flash log, 0 if it is not
+    // logged. The readings of the individual sensors follow on home/weather_station/sensors/<id>. Returns false, leaving
+    // the report in flight untouched, unless Accepting().
+    bool ReportWeather(
+        const Sensor::Measurement& measurement, const WindowStats& stats, uint64_t timestamp, uint32_t sequence = 0,
+        std::vector<SensorReading> sensors = {}
+    );
+    // Publishes logged records that did not make it to the broker, first..last are their sequence numbers
+    void ReportBacklog(std::string payload, uint32_t first, uint32_t last);
+    // Forwards readings of peer stations (gateway role), at most once
+    void ReportPeers(std::string payload);
+    bool Ready() const
+    {
+        return connected_ && reportingState_ == ReportingState::Idle;
+    }
+    // Nothing is being published, a report that waits for the connection is replaced by the next one
+    bool Accepting() const
+    {
+        return reportingState_ == ReportingState::Idle || reportingState_ == ReportingState::Pending;
+    }
+    // Called with the sequence range of every report that was fully published
+    const ExportStats& Stats() const
+    {
+        return exportStats_;
+    }
+    // JSON payload of the stats topic, timestamp in UTC microseconds (0 leaves the time out)
+    static std::string FormatStats(const WindowStats& stats, uint64_t timestamp);
+    // JSON payload of a sensor topic with the derived metrics, co2 is left out for sensors without it
+    static std::string FormatSensor(const Sensor::Measurement& measurement);
+    // JSON payload of the derived topic: dew point, absolute humidity and heat index
+    static std::string FormatDerived(const Sensor::Measurement& measurement);
+    // Time from starting the connection to CONNACK (including the TLS handshake) and heap use
+    void PrintConnectStats() const;
+    // Aborts the connection as if the link had dropped, the usual reconnect path brings it back. With forgetServer the
+    // broker is resolved again before reconnecting.
+    void DropConnection(bool forgetServer = false);
+    // Publish latency percentiles, throughput, disconnects and how long it took to recover from them
+    void PrintHealth() const;
+
+    void SetDeliveryCallback(std::function<void(uint32_t, uint32_t)> f)
+    {
+        onDelivered_ = std::move(f);
+    }
+    void SetQos(uint8_t qos)
+    {
+        qos_ = qos;
+    }
 
-    void ReportWeather(int co2, float temp, float hum);
+    // Commands arrive on home/weather_station/cmd (whole fleet) and home/weather_station/<client id>/cmd.
+    // Returns false if none is waiting.
+    bool TakeCommand(std::string& command);
+    // Publishes the outcome of a command on home/weather_station/<client id>/ack
+    void Acknowledge(const std::string& response);
 
 private:
     void dnsFound(const ip_addr_t *ipaddr);
@@ -53,14 +120,44 @@ private:
     void onPublish(err_t err);
     static void mqttPublishRequestCallback(void *arg, err_t err)
     {
+#ifdef MQTT_SOAK
+        static_cast<MQTT*>(arg)->soakPublish(err);
+#else
         static_cast<MQTT*>(arg)->onPublish(err);
+#endif
+    }
+#ifdef MQTT_SOAK
+    // Broker latency and packet loss for the soak test, between lwIP and onPublish()
+    void soakPublish(err_t err);
+    static void soakReleaseCallback(void *arg)
+    {
+        auto self = static_cast<MQTT*>(arg);
+        self->onPublish(self->soakResult_);
     }
+#endif
 
+    void resolve();
     void startClient();
+    void scheduleReconnect();
+    void reconnect();
+    static void reconnectCallback(void *arg)
+    {
+        static_cast<MQTT*>(arg)->reconnect();
+    }
+    void recordConnect();
+    // start is when formatting the payload began, for the CPU time statistics
+    err_t publish(const char* topic, const std::string& payload, uint64_t start);
 
     void reportCO2();
     void reportTemperature();
     void reportHumidity();
+    void reportDerived();
+    void reportStats();
+    void reportSensor();
+    void reportBacklog();
+    void reportPeers();
+    void finishReport();
+    void abandonReport();
 
     enum class ReportingState
     {
@@ -68,7 +165,12 @@ private:
         Pending,
         ReportingCO2,
         ReportingTemperature,
-        ReportingHumidity
+        ReportingHumidity,
+        ReportingDerived,
+        ReportingStats,
+        ReportingSensors,
+        ReportingBacklog,
+        ReportingPeers
     };
     ReportingState reportingState_ = ReportingState::Idle;
 
@@ -77,9 +179,70 @@ private:
     std::string clientId_;
     ip_addr_t mqttServer_;
     bool connected_ = false;
+    bool resolved_ = false;
+    bool suspended_ = false;
+    static constexpr uint32_t minReconnectDelay = 1000;
+    static constexpr uint32_t maxReconnectDelay = 60000;
+    uint32_t reconnectDelay_ = minReconnectDelay;
 
-    int co2_ = 0;
-    float temp_ = 0;
-    float hum_ = 0;
+    struct Health
+    {
+        Histogram latencyUs;
+        RunningStats recoveryMs;
+        uint32_t published = 0;
+        uint32_t failed = 0;
+        uint32_t disconnects = 0;
+        uint64_t bytes = 0;
+    };
+    Health health_;
+    uint64_t startedAt_ = 0;
+    uint64_t publishedAt_ = 0;
+    uint64_t disconnectedAt_ = 0;
+
+    struct ConnectStats
+    {
+        uint32_t connects = 0;
+        uint32_t resumed = 0;
+        uint64_t lastUs = 0;
+        uint64_t maxUs = 0;
+        uint64_t totalUs = 0;
+        int heapGrowth = 0;
+        int heapArena = 0;
+    };
+    ConnectStats connectStats_;
+    uint64_t connectStart_ = 0;
+    int heapBeforeConnect_ = 0;
+#ifdef MQTT_TLS
+    // Handed to the next connection so the broker can resume it instead of running a full handshake
+    altcp_tls_session session_;
+    bool haveSession_ = false;
+#endif
+    uint8_t qos_ = 1;
+
+    static constexpr size_t maxCommandSize = 256;
+    static constexpr size_t maxPendingCommands = 4;
+    std::string commandTopic_;
+    std::string ackTopic_;
+    std::string incoming_;
+    bool receivingCommand_ = false;
+    std::deque<std::string> commands_;
+
+    Sensor::Measurement measurement_;
+    WindowStats stats_;
+    uint64_t timestamp_ = 0;
+    std::vector<SensorReading> sensors_;
+    size_t sensorIndex_ = 0;
+    ExportStats exportStats_;
+
+    std::string backlog_;
+    uint32_t firstSequence_ = 0;
+    uint32_t lastSequence_ = 0;
+    bool reportFailed_ = false;
+    std::function<void(uint32_t, uint32_t)> onDelivered_;
+#ifdef MQTT_SOAK
+    err_t soakResult_ = ERR_OK;
+    uint32_t soakSeed_ = 1;
+    uint32_t soakLost_ = 0;
+#endif
 };
 } // namespace weather_station
\ No newline at end of file
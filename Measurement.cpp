@@ -0,0 +1,22 @@
+#include "Measurement.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+
+namespace weather_station
+{
+void writeCenti(std::ostream& os, int32_t value)
+{
+    os << CentiText(value).c_str();
+}
+
+CentiText::CentiText(int32_t value)
+{
+    auto magnitude = std::labs(value);
+    snprintf(
+        text_.data(), text_.size(), "%s%ld.%02ld", value < 0 ? "-" : "", static_cast<long>(magnitude / 100),
+        static_cast<long>(magnitude % 100)
+    );
+}
+} // namespace weather_station
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+namespace weather_station
+{
+// One sample in integer centi-units, from the driver through the filters, the FIFO to core 1, the display and the
+// exporters. The M0+ has no FPU, so every float operation on the way used to be a call into the software routines.
+// Values only become text with two decimals when they leave the device. The time of the sample is kept next to it,
+// see Sensor::GetTime().
+struct Measurement
+{
+    // Bits of Valid, a sensor only sets the metrics it measures
+    enum : uint8_t { HasTemperature = 1, HasHumidity = 2, HasCO2 = 4 };
+
+    int16_t Temperature = 0; // 0.01 C
+    uint16_t Humidity = 0;   // 0.01 %
+    uint16_t CO2 = 0;        // ppm
+    uint8_t Valid = 0;
+
+    bool has(uint8_t metrics) const
+    {
+        return (Valid & metrics) == metrics;
+    }
+};
+static_assert(sizeof(Measurement) == 8);
+
+// Centi-units as a number with two decimals, without going through float
+void writeCenti(std::ostream& os, int32_t value);
+
+// The same as a NUL terminated string, for the exporters that format with snprintf
+struct CentiText
+{
+    explicit CentiText(int32_t value);
+    const char* c_str() const
+    {
+        return text_.data();
+    }
+
+private:
+    std::array<char, 13> text_;
+};
+} // namespace weather_station
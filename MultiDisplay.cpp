@@ -1,4 +1,5 @@
 #include "MultiDisplay.h"
+#include "Trace.h"
 
 #include "ino_compat.h"
 
@@ -170,48 +171,60 @@ void MultiDisplay::refreshDisplay()
         pushToRegisters();
     }
     if (now - lastElementSwitch_ > switchDelay_) {
+        // Only the calls that switch elements are traced, the idle ones would flood the ring
+        Trace::Scope scope(Trace::Point::RefreshDisplay);
         lastElementSwitch_ = now;
+        nextElement();
+        pushToRegisters();
+    }
+}
 
-        if (mode_ == Mode::Segment) {
-            displayedElementIdx_ = (displayedElementIdx_ + 1) % 8;
+void MultiDisplay::nextElement()
+{
+    if (mode_ == Mode::Segment) {
+        displayedElementIdx_ = (displayedElementIdx_ + 1) % 8;
 
-            for (int i = 0; i < registerValues_.size(); ++i) {
-                auto& registerValues = registerValues_[i];
-                const auto& activeSegments = activeSegments_[i];
-                auto segmentPin = segmentPins_[displayedElementIdx_];
-                registerValues = 1 << segmentPin;
+        for (int i = 0; i < registerValues_.size(); ++i) {
+            auto& registerValues = registerValues_[i];
+            const auto& activeSegments = activeSegments_[i];
+            auto segmentPin = segmentPins_[displayedElementIdx_];
+            registerValues = 1 << segmentPin;
 
-                for (int digit = 0; digit < 4; ++digit) {
-                    if ((activeSegments[digit] & (1 << displayedElementIdx_)) == 0) {
-                        registerValues |= (1 << digitPins_[digit]);
-                    }
+            for (int digit = 0; digit < 4; ++digit) {
+                if ((activeSegments[digit] & (1 << displayedElementIdx_)) == 0) {
+                    registerValues |= (1 << digitPins_[digit]);
                 }
             }
-        } else if (mode_ == Mode::Digit) {
-            displayedElementIdx_ = (displayedElementIdx_ + 1) % 4;
-
-            for (int i = 0; i < registerValues_.size(); ++i) {
-                auto& registerValues = registerValues_[i];
-                const auto& activeSegments = activeSegments_[i];
-                registerValues = 0;
-
-                for (int d = 0; d < 4; ++d) {
-                    if (d != displayedElementIdx_) {
-                        registerValues |= 1 << digitPins_[d];
-                    }
+        }
+    } else if (mode_ == Mode::Digit) {
+        displayedElementIdx_ = (displayedElementIdx_ + 1) % 4;
+
+        for (int i = 0; i < registerValues_.size(); ++i) {
+            auto& registerValues = registerValues_[i];
+            const auto& activeSegments = activeSegments_[i];
+            registerValues = 0;
+
+            for (int d = 0; d < 4; ++d) {
+                if (d != displayedElementIdx_) {
+                    registerValues |= 1 << digitPins_[d];
                 }
-                auto segments = activeSegments[displayedElementIdx_];
-                for (int s = 0; s < 8; ++s) {
-                    if (segments & (1 << s)) {
-                        registerValues |= 1 << segmentPins_[s];
-                    }
+            }
+            auto segments = activeSegments[displayedElementIdx_];
+            for (int s = 0; s < 8; ++s) {
+                if (segments & (1 << s)) {
+                    registerValues |= 1 << segmentPins_[s];
                 }
             }
         }
-        pushToRegisters();
     }
 }
 
+void MultiDisplay::blank()
+{
+    std::for_each(registerValues_.begin(), registerValues_.end(), [](auto& val) { val = 0; });
+    pushToRegisters();
+}
+
 void MultiDisplay::pushToRegisters()
 {
     for (int regVal = 15; regVal >= 0; --regVal) {
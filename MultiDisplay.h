@@ -20,6 +20,11 @@ public:
     void setNumberF(int idx, float num, int8_t decPlaces);
     void setSegment(int idx, int digit, uint8_t segments);
     void refreshDisplay();
+    // Moves on to the next segment or digit and computes the register values lighting it, refreshDisplay() calls it
+    // when the element's time slot is over and shifts the result out
+    void nextElement();
+    // Switches all elements off until the next refreshDisplay()
+    void blank();
 
     void incDelay()
     {
@@ -35,6 +40,14 @@ public:
             idleDelay_ = 0;
         }
     }
+    // Share of each element's time slot it is lit for
+    void setBrightness(int percent)
+    {
+        idleDelay_ = switchDelay_ * (100 - percent) / 100;
+        if (idleDelay_ >= switchDelay_) {
+            idleDelay_ = switchDelay_ - 50;
+        }
+    }
     void switchMode()
     {
         if (mode_ == Mode::Segment) {
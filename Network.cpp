@@ -0,0 +1,104 @@
+#include "Network.h"
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/unique_id.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+
+namespace weather_station
+{
+bool Network::init()
+{
+    if (initialized_) {
+        return true;
+    }
+    if (cyw43_arch_init() != 0) {
+        std::cout << "cyw43 init failed!\n";
+        return false;
+    }
+    cyw43_arch_enable_sta_mode();
+    initialized_ = true;
+    return true;
+}
+
+void Network::deinit()
+{
+    if (initialized_) {
+        cyw43_arch_deinit();
+        initialized_ = false;
+    }
+}
+
+bool Network::connect(int attempts)
+{
+    // allow the firmware/state machine a short moment after enabling STA mode
+    sleep_ms(2000);
+
+    for (int attempt = 1;; ++attempt) {
+        int rc = cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000);
+        if (rc == 0) {
+            break;
+        }
+        std::cerr << "failed to connect (code " << rc << ").\n";
+        if (attempt >= attempts) {
+            return false;
+        }
+        std::cout << "Retrying in 5 seconds...\n";
+        sleep_ms(5000);
+    }
+    std::cout << "Connected.\n";
+    haveBssid_ = cyw43_wifi_get_bssid(&cyw43_state, bssid_.data()) == 0;
+    return true;
+}
+
+bool Network::rejoin()
+{
+    auto rc = cyw43_arch_wifi_connect_bssid_async(
+        WIFI_SSID, haveBssid_ ? bssid_.data() : nullptr, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK
+    );
+    if (rc != 0) {
+        std::cerr << "Rejoin failed to start (code " << rc << ")\n";
+        return false;
+    }
+    return true;
+}
+
+bool Network::linkUp()
+{
+    return cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP;
+}
+
+bool Network::linkFailed()
+{
+    return cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) < 0;
+}
+
+void Network::leave()
+{
+    cyw43_arch_lwip_begin();
+    cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+    cyw43_arch_lwip_end();
+}
+
+void Network::setPowerManagement(uint32_t pm)
+{
+    cyw43_arch_lwip_begin();
+    cyw43_wifi_pm(&cyw43_state, pm);
+    cyw43_arch_lwip_end();
+}
+
+const std::string& Network::stationId()
+{
+    static std::string id;
+    if (id.empty()) {
+        char unique_buf[4] = {0};
+        pico_get_unique_board_id_string(unique_buf, sizeof(unique_buf));
+        id = std::string("pico") + unique_buf;
+        std::transform(id.begin(), id.end(), id.begin(), [](unsigned char c) { return std::tolower(c); });
+    }
+    return id;
+}
+} // namespace weather_station
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace weather_station
+{
+// Owns the CYW43 radio and the Wi-Fi association shared by all network clients
+class Network
+{
+public:
+    static bool init();
+    static void deinit();
+    // Blocks until associated, gives up after the given number of attempts
+    static bool connect(int attempts = 3);
+
+    // Non-blocking rejoin of the access point found by connect(), poll linkUp()/linkFailed() for the outcome
+    static bool rejoin();
+    static bool linkUp();
+    static bool linkFailed();
+    // Drops the association, the radio stays initialized but idle
+    static void leave();
+    // One of the CYW43_*_PM constants
+    static void setPowerManagement(uint32_t pm);
+
+    // "pico" followed by the lower-case board id, used as MQTT client id and station tag
+    static const std::string& stationId();
+
+private:
+    static inline bool initialized_ = false;
+    // Cached by connect() so rejoining does not have to pick an access point again
+    static inline std::array<uint8_t, 6> bssid_ = {};
+    static inline bool haveBssid_ = false;
+};
+} // namespace weather_station
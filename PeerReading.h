@@ -0,0 +1,27 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace weather_station
+{
+// Datagram a peer station sends to the gateway (UdpExporter::Format::Compact), one reading per datagram.
+// Both ends are RP2040s, fields are little-endian as laid out in memory.
+struct PeerReading
+{
+    static constexpr uint16_t magic = 0x5357; // "WS"
+    static constexpr uint8_t currentVersion = 1;
+
+    uint16_t header = magic;
+    uint8_t version = currentVersion;
+    uint8_t reserved = 0;
+    std::array<char, 12> station = {}; // NUL padded
+    uint32_t sequence = 0;             // flash log sequence, survives reboots
+    uint32_t stamp = 0;                // UTC seconds, 0 if the peer's clock is not synced
+    uint16_t co2 = 0;
+    int16_t temperature = 0; // centi-degrees
+    uint16_t humidity = 0;   // centi-percent
+    uint16_t padding = 0;
+};
+static_assert(sizeof(PeerReading) == 32);
+} // namespace weather_station
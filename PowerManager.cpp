@@ -0,0 +1,88 @@
+#include "PowerManager.h"
+#include "Button.h"
+
+#include <pico/stdlib.h>
+#include <hardware/clocks.h>
+
+#include <iostream>
+
+namespace weather_station
+{
+PowerManager::PowerManager()
+    : fullHz_(clock_get_hz(clk_sys))
+    , hz_(fullHz_)
+{
+}
+
+void PowerManager::configure(const Settings& settings, uint64_t now)
+{
+    mode_ = settings.power;
+    displayTimeout_ = settings.displayTimeout;
+    lastActivity_ = now;
+}
+
+bool PowerManager::activity(uint64_t now)
+{
+    bool wasOff = !displayOn(now);
+    lastActivity_ = now;
+    return wasOff;
+}
+
+bool PowerManager::displayOn(uint64_t now) const
+{
+    return mode_ == Settings::PowerMode::Normal || displayTimeout_ == 0 || now - lastActivity_ < displayTimeout_;
+}
+
+void PowerManager::setClock(uint32_t hz)
+{
+    if (hz == hz_) {
+        return;
+    }
+    // Only the divider changes, the PLL keeps running and does not have to lock again
+    clock_configure(
+        clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX, CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS,
+        fullHz_, hz
+    );
+    hz_ = hz;
+    if (onClockChange_) {
+        onClockChange_();
+    }
+}
+
+void PowerManager::idle(uint64_t now)
+{
+    if (mode_ != Settings::PowerMode::Low) {
+        setClock(fullHz_);
+        return;
+    }
+    if (busy_ && busy_()) {
+        // Sleeping would also outlast the I2C phase timeout, the next iteration finishes the transfer
+        ++busySkips_;
+        return;
+    }
+    auto start = time_us_64();
+    auto deadline = make_timeout_time_ms(tickMs);
+    setClock(fullHz_ / idleDivider);
+    // Any interrupt ends the WFE, keep waiting unless it queued a button gesture
+    while (!Button::Pending()) {
+        if (best_effort_wfe_or_timeout(deadline)) {
+            break;
+        }
+    }
+    if (Button::Pending()) {
+        ++buttonWakes_;
+    }
+    setClock(fullHz_);
+    sleptUs_ += time_us_64() - start;
+    ++sleeps_;
+}
+
+void PowerManager::printStats() const
+{
+    if (sleeps_ == 0) {
+        return;
+    }
+    std::cout << "Power: " << sleeps_ << " sleeps, " << sleptUs_ / 1000000 << " s asleep at " << fullHz_ / idleDivider
+              << " Hz, " << buttonWakes_ << " button wakes, " << busySkips_ << " skipped for I2C transfers\n";
+}
+} // namespace weather_station
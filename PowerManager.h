@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Settings.h"
+
+#include <cstdint>
+#include <functional>
+
+namespace weather_station
+{
+// Low power execution for core 0. In Low mode every loop iteration ends by waiting in WFE until the next tick or a
+// button gesture with clk_sys divided down, and the display is switched off after displayTimeout without a button
+// press. The clock goes back up on wake so the actual work finishes quickly (race to idle). The timer and alarms run
+// from clk_ref and are not affected; peripherals clocked from clk_sys (I2C) are told through the clock callback.
+class PowerManager
+{
+public:
+    PowerManager();
+
+    void configure(const Settings& settings, uint64_t now);
+    void setClockCallback(std::function<void()> f)
+    {
+        onClockChange_ = std::move(f);
+    }
+    // While it returns true the loop does not sleep, e.g. an I2C transfer the clock change would cut off
+    void setBusyCallback(std::function<bool()> f)
+    {
+        busy_ = std::move(f);
+    }
+
+    // A button was used. Returns true if this only woke the display, the gesture should not act on anything else.
+    bool activity(uint64_t now);
+    bool displayOn(uint64_t now) const;
+    // Called at the end of each loop iteration, returns right away in Normal mode
+    void idle(uint64_t now);
+    void printStats() const;
+
+private:
+    void setClock(uint32_t hz);
+
+    static constexpr uint32_t tickMs = 250;
+    static constexpr uint32_t idleDivider = 4;
+
+    Settings::PowerMode mode_ = Settings::PowerMode::Normal;
+    uint32_t displayTimeout_ = 0;
+    uint64_t lastActivity_ = 0;
+    const uint32_t fullHz_;
+    uint32_t hz_;
+    std::function<void()> onClockChange_;
+    std::function<bool()> busy_;
+
+    uint64_t sleptUs_ = 0;
+    uint32_t sleeps_ = 0;
+    uint32_t buttonWakes_ = 0;
+    uint32_t busySkips_ = 0;
+};
+} // namespace weather_station
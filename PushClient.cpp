@@ -0,0 +1,303 @@
+#include "PushClient.h"
+#include "Network.h"
+#include "ino_compat.h"
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "lwip/dns.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace weather_station
+{
+PushClient::PushClient(std::string host, uint16_t port, Protocol protocol, std::string path)
+    : host_(std::move(host))
+    , port_(port)
+    , protocol_(protocol)
+    , path_(std::move(path))
+{
+    Network::init();
+}
+
+PushClient::~PushClient()
+{
+    std::cout << "Closing push client\n";
+    cyw43_arch_lwip_begin();
+    close();
+    cyw43_arch_lwip_end();
+}
+
+void PushClient::add(std::string_view line)
+{
+    if (pending_.size() + line.size() + 1 > maxPending) {
+        ++dropped_;
+        std::cout << "Push queue full, " << dropped_ << " points dropped\n";
+        return;
+    }
+    if (pendingLines_ == 0) {
+        firstPending_ = millis();
+    }
+    pending_.append(line);
+    pending_ += '\n';
+    ++pendingLines_;
+}
+
+void PushClient::addWeather(const Measurement& measurement, uint64_t timestamp)
+{
+    std::stringstream ss;
+    ss << "weather,station=" << Network::stationId() << " co2=" << measurement.CO2 << "i,temperature=";
+    writeCenti(ss, measurement.Temperature);
+    ss << ",humidity=";
+    writeCenti(ss, measurement.Humidity);
+    if (timestamp != 0) {
+        // Line protocol defaults to nanoseconds
+        ss << " " << timestamp * 1000;
+    }
+    add(ss.str());
+}
+
+void PushClient::process(uint64_t now)
+{
+    cyw43_arch_lwip_begin();
+    switch (state_) {
+        case State::Disconnected:
+            if (pendingLines_ > 0 && now >= retryAt_) {
+                connect();
+            }
+            break;
+        case State::Idle:
+            if (pendingLines_ >= batchLines || (pendingLines_ > 0 && now - firstPending_ >= flushInterval)) {
+                startRequest();
+            }
+            break;
+        default:
+            if (now - stateSince_ > timeout) {
+                failed("timed out");
+            }
+            break;
+    }
+    cyw43_arch_lwip_end();
+}
+
+void PushClient::setState(State state)
+{
+    state_ = state;
+    stateSince_ = millis();
+}
+
+void PushClient::connect()
+{
+    setState(State::Resolving);
+    auto err = dns_gethostbyname(host_.c_str(), &remote_addr, PushClient::dnsFoundCallback, this);
+    if (err == ERR_OK) {
+        dnsFound(&remote_addr);
+    } else if (err != ERR_INPROGRESS) {
+        failed("DNS request failed");
+    }
+}
+
+void PushClient::dnsFound(const ip_addr_t* ipaddr)
+{
+    if (state_ != State::Resolving) {
+        return;
+    }
+    if (!ipaddr) {
+        failed("DNS request failed");
+        return;
+    }
+    remote_addr = *ipaddr;
+    pcb = tcp_new_ip_type(IP_GET_TYPE(&remote_addr));
+    if (!pcb) {
+        failed("failed to create pcb");
+        return;
+    }
+    tcp_arg(pcb, this);
+    tcp_sent(pcb, &PushClient::tcp_client_sent);
+    tcp_recv(pcb, &PushClient::tcp_client_recv);
+    tcp_err(pcb, &PushClient::tcp_client_err);
+
+    setState(State::Connecting);
+    if (tcp_connect(pcb, &remote_addr, port_, &PushClient::tcp_client_connected) != ERR_OK) {
+        failed("connect failed");
+    }
+}
+
+err_t PushClient::conn(tcp_pcb* arg, err_t err)
+{
+    if (err != ERR_OK) {
+        return failed("connect failed");
+    }
+    std::cout << "Push client connected to " << ipaddr_ntoa(&remote_addr) << ":" << port_ << "\n";
+    retryDelay_ = 1000;
+    setState(State::Idle);
+    return ERR_OK;
+}
+
+void PushClient::startRequest()
+{
+    body_ = std::move(pending_);
+    pending_.clear();
+    pendingLines_ = 0;
+    if (protocol_ == Protocol::Http) {
+        out_ = "POST " + path_ + " HTTP/1.1\r\nHost: " + host_ +
+               "\r\nContent-Type: text/plain\r\nConnection: keep-alive\r\nContent-Length: " +
+               std::to_string(body_.size()) + "\r\n\r\n" + body_;
+    } else {
+        out_ = body_;
+    }
+    written_ = 0;
+    acked_ = 0;
+    response_.clear();
+    setState(State::Sending);
+    if (send() != ERR_OK) {
+        failed("write failed");
+    }
+}
+
+err_t PushClient::send()
+{
+    // Write as much as the send buffer takes, the rest goes out from sent() as segments are acknowledged
+    while (written_ < out_.size()) {
+        size_t len = std::min<size_t>(tcp_sndbuf(pcb), out_.size() - written_);
+        if (len == 0) {
+            break;
+        }
+        u8_t flags = TCP_WRITE_FLAG_COPY;
+        if (written_ + len < out_.size()) {
+            flags |= TCP_WRITE_FLAG_MORE;
+        }
+        auto err = tcp_write(pcb, out_.data() + written_, len, flags);
+        if (err == ERR_MEM) {
+            break;
+        }
+        if (err != ERR_OK) {
+            return err;
+        }
+        written_ += len;
+    }
+    return tcp_output(pcb);
+}
+
+err_t PushClient::sent(tcp_pcb* tpcb, u16_t len)
+{
+    if (state_ != State::Sending) {
+        return ERR_OK;
+    }
+    acked_ += len;
+    if (acked_ < out_.size()) {
+        auto err = send();
+        return err == ERR_OK ? static_cast<err_t>(ERR_OK) : failed("write failed");
+    }
+    if (protocol_ == Protocol::Line) {
+        completeRequest();
+    } else {
+        setState(State::AwaitingResponse);
+    }
+    return ERR_OK;
+}
+
+void PushClient::completeRequest()
+{
+    body_.clear();
+    out_.clear();
+    setState(State::Idle);
+}
+
+err_t PushClient::recv(tcp_pcb* arg, pbuf* buf, err_t err)
+{
+    if (!buf) {
+        if (state_ == State::Idle) {
+            std::cout << "Push connection closed by server\n";
+            setState(State::Disconnected);
+            return close();
+        }
+        return failed("connection closed by server");
+    }
+    tcp_recved(pcb, buf->tot_len);
+    if (protocol_ == Protocol::Http) {
+        auto offset = response_.size();
+        response_.resize(offset + buf->tot_len);
+        pbuf_copy_partial(buf, response_.data() + offset, buf->tot_len, 0);
+    }
+    pbuf_free(buf);
+    if (protocol_ == Protocol::Line || (state_ != State::Sending && state_ != State::AwaitingResponse)) {
+        return ERR_OK;
+    }
+
+    auto headerEnd = response_.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        return ERR_OK;
+    }
+    std::string header = response_.substr(0, headerEnd);
+    std::transform(header.begin(), header.end(), header.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t contentLength = 0;
+    if (auto pos = header.find("content-length:"); pos != std::string::npos) {
+        contentLength = std::strtoul(header.c_str() + pos + 15, nullptr, 10);
+    }
+    if (response_.size() < headerEnd + 4 + contentLength) {
+        return ERR_OK;
+    }
+
+    int status = response_.size() > 9 ? std::atoi(response_.c_str() + 9) : 0;
+    if (status >= 500) {
+        return failed("server error " + std::to_string(status));
+    }
+    if (status < 200 || status >= 300) {
+        // The server will not take this batch no matter how often we send it
+        std::cout << "Push rejected with status " << status << ": " << response_.substr(headerEnd + 4) << "\n";
+    }
+    completeRequest();
+    if (header.find("connection: close") != std::string::npos) {
+        setState(State::Disconnected);
+        return close();
+    }
+    return ERR_OK;
+}
+
+void PushClient::error(err_t err)
+{
+    // The pcb is already freed by lwIP
+    pcb = nullptr;
+    failed("error " + std::to_string(err));
+}
+
+err_t PushClient::failed(std::string_view reason)
+{
+    std::cout << "Push client " << reason << ", retrying in " << retryDelay_ << " ms\n";
+    if (!body_.empty()) {
+        pending_.insert(0, body_);
+        body_.clear();
+        pendingLines_ = std::count(pending_.begin(), pending_.end(), '\n');
+        firstPending_ = millis();
+    }
+    out_.clear();
+    setState(State::Disconnected);
+    retryAt_ = millis() + retryDelay_;
+    retryDelay_ = std::min<uint32_t>(retryDelay_ * 2, 60000);
+    return close();
+}
+
+err_t PushClient::close()
+{
+    if (!pcb) {
+        return ERR_OK;
+    }
+    tcp_arg(pcb, nullptr);
+    tcp_sent(pcb, nullptr);
+    tcp_recv(pcb, nullptr);
+    tcp_err(pcb, nullptr);
+    auto res = tcp_close(pcb);
+    if (res != ERR_OK) {
+        std::cout << "close failed " << (int)res << ", calling abort\n";
+        tcp_abort(pcb);
+        res = ERR_ABRT;
+    }
+    pcb = nullptr;
+    return res;
+}
+} // namespace weather_station
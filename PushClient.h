@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Measurement.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+
+#include <string>
+#include <string_view>
+
+namespace weather_station
+{
+// Pushes InfluxDB line protocol points over one long-lived TCP connection, either as HTTP/1.1 keep-alive POSTs or
+// as raw lines (e.g. a socket_listener). Points are batched, writes follow the send buffer space reported by lwIP and
+// a failed batch is queued again and retried after reconnecting.
+class PushClient
+{
+public:
+    enum class Protocol { Http, Line };
+
+    PushClient(std::string host, uint16_t port, Protocol protocol, std::string path = "/write?db=weather");
+    ~PushClient();
+
+    void add(std::string_view line);
+    // timestamp is UTC microseconds, 0 leaves it to the server
+    void addWeather(const Measurement& measurement, uint64_t timestamp);
+
+    // Connects, flushes batches and retries, call from the main loop
+    void process(uint64_t now);
+
+private:
+    enum class State { Disconnected, Resolving, Connecting, Idle, Sending, AwaitingResponse };
+
+    static void dnsFoundCallback(const char* hostname, const ip_addr_t* ipaddr, void* arg)
+    {
+        static_cast<PushClient*>(arg)->dnsFound(ipaddr);
+    }
+    static err_t tcp_client_sent(void* p, tcp_pcb* arg, u16_t len)
+    {
+        return ((PushClient*)p)->sent(arg, len);
+    }
+    static err_t tcp_client_recv(void* p, tcp_pcb* arg, pbuf* buf, err_t err)
+    {
+        return ((PushClient*)p)->recv(arg, buf, err);
+    }
+    static void tcp_client_err(void* p, err_t err)
+    {
+        ((PushClient*)p)->error(err);
+    }
+    static err_t tcp_client_connected(void* p, tcp_pcb* arg, err_t err)
+    {
+        return ((PushClient*)p)->conn(arg, err);
+    }
+    void dnsFound(const ip_addr_t* ipaddr);
+    err_t sent(tcp_pcb* tpcb, u16_t len);
+    err_t recv(tcp_pcb* arg, pbuf* buf, err_t err);
+    void error(err_t err);
+    err_t conn(tcp_pcb* arg, err_t err);
+
+    void setState(State state);
+    void connect();
+    void startRequest();
+    err_t send();
+    void completeRequest();
+    err_t failed(std::string_view reason);
+    err_t close();
+
+    State state_ = State::Disconnected;
+
+    const std::string host_;
+    const uint16_t port_;
+    const Protocol protocol_;
+    const std::string path_;
+
+    ip_addr_t remote_addr;
+    tcp_pcb* pcb = nullptr;
+
+    std::string pending_;  // lines waiting for the next batch
+    std::string body_;     // lines of the batch in flight, queued again if it fails
+    std::string out_;      // request being written
+    std::string response_; // HTTP response collected so far
+    size_t written_ = 0;
+    size_t acked_ = 0;
+    size_t pendingLines_ = 0;
+    uint64_t firstPending_ = 0;
+    uint64_t stateSince_ = 0;
+    uint64_t retryAt_ = 0;
+    uint32_t retryDelay_ = 1000;
+    uint32_t dropped_ = 0;
+
+    static constexpr size_t batchLines = 10;
+    static constexpr size_t maxPending = 8 * 1024;
+    static constexpr uint64_t flushInterval = 60000;
+    static constexpr uint64_t timeout = 10000;
+};
+} // namespace weather_station
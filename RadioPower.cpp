@@ -0,0 +1,152 @@
+#include "RadioPower.h"
+#include "MQTT.h"
+#include "FlashLog.h"
+#include "Network.h"
+
+#include <pico/cyw43_arch.h>
+
+#include <iostream>
+
+namespace weather_station
+{
+RadioPower::RadioPower(MQTT& mqtt, FlashLog& log)
+    : mqtt_(mqtt)
+    , log_(log)
+    , lastSent_(log.sent())
+{
+}
+
+void RadioPower::configure(const Settings& settings, uint64_t now)
+{
+    wakeInterval_ = settings.wakeInterval;
+    if (settings.radio == mode_) {
+        return;
+    }
+    account(now);
+    mode_ = settings.radio;
+    switch (mode_) {
+        case Settings::RadioMode::On:
+        case Settings::RadioMode::PowerSave:
+            Network::setPowerManagement(mode_ == Settings::RadioMode::On ? CYW43_PERFORMANCE_PM : CYW43_AGGRESSIVE_PM);
+            if (state_ == State::Sleeping) {
+                // Bring the radio back, On is entered once MQTT is up again
+                enter(State::Joining, now);
+                Network::rejoin();
+            }
+            break;
+        case Settings::RadioMode::Duty:
+            // Finish what is queued in the log first, then go to sleep
+            Network::setPowerManagement(CYW43_PERFORMANCE_PM);
+            enter(State::Publishing, now);
+            break;
+    }
+}
+
+void RadioPower::enter(State state, uint64_t now)
+{
+    account(now);
+    state_ = state;
+    stateSince_ = now;
+}
+
+void RadioPower::sleep(uint64_t now)
+{
+    mqtt_.Disconnect();
+    Network::leave();
+    enter(State::Sleeping, now);
+    nextWake_ = now + wakeInterval_;
+}
+
+void RadioPower::process(uint64_t now)
+{
+    if (log_.sent() > lastSent_) {
+        published_ += log_.sent() - lastSent_;
+        lastSent_ = log_.sent();
+    }
+    bool timedOut = now - stateSince_ > wakeTimeout;
+    switch (state_) {
+        case State::On:
+            break;
+        case State::Sleeping:
+            if (now >= nextWake_) {
+                ++wakes_;
+                enter(State::Joining, now);
+                if (!Network::rejoin()) {
+                    ++failedWakes_;
+                    sleep(now);
+                }
+            }
+            break;
+        case State::Joining:
+            if (Network::linkUp()) {
+                enter(State::Connecting, now);
+                mqtt_.Reconnect();
+            } else if (Network::linkFailed() || timedOut) {
+                std::cout << "Rejoin failed, trying again at the next wake\n";
+                ++failedWakes_;
+                sleep(now);
+            }
+            break;
+        case State::Connecting:
+            if (mqtt_.Ready()) {
+                enter(mode_ == Settings::RadioMode::Duty ? State::Publishing : State::On, now);
+            } else if (timedOut) {
+                ++failedWakes_;
+                sleep(now);
+            }
+            break;
+        case State::Publishing:
+            // The main loop replays the backlog while MQTT is ready, wait until it has caught up
+            if (mqtt_.Ready() && !log_.hasUnsent()) {
+                // Flush the delivery watermark now, the log would otherwise write it while the radio sleeps anyway
+                log_.flush();
+                sleep(now);
+            } else if (timedOut && !mqtt_.Ready()) {
+                ++failedWakes_;
+                sleep(now);
+            }
+            break;
+    }
+}
+
+void RadioPower::account(uint64_t now)
+{
+    auto elapsed = now - accountedUntil_;
+    accountedUntil_ = now;
+    switch (state_) {
+        case State::Sleeping:
+            idleMs_ += elapsed;
+            break;
+        case State::On:
+            if (mode_ == Settings::RadioMode::PowerSave) {
+                powerSaveMs_ += elapsed;
+                break;
+            }
+            activeMs_ += elapsed;
+            break;
+        default:
+            activeMs_ += elapsed;
+            break;
+    }
+}
+
+void RadioPower::printStats(uint64_t now)
+{
+    account(now);
+    auto total = activeMs_ + powerSaveMs_ + idleMs_;
+    if (total == 0) {
+        return;
+    }
+    // mA * ms = uC
+    float radioCharge = activeMs_ * activeMa + powerSaveMs_ * powerSaveMa + idleMs_ * idleMa;
+    float averageMa = baseMa + radioCharge / total;
+    std::cout << "Radio: active " << activeMs_ / 1000 << " s, power save " << powerSaveMs_ / 1000 << " s, off "
+              << idleMs_ / 1000 << " s, " << wakes_ << " wakes (" << failedWakes_ << " failed), ~" << averageMa
+              << " mA average";
+    if (published_ > 0) {
+        // uC * V = uJ
+        std::cout << ", ~" << radioCharge * volts / 1000 / published_ << " mJ radio energy per published sample";
+    }
+    std::cout << "\n";
+}
+} // namespace weather_station
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Settings.h"
+
+#include <cstdint>
+
+namespace weather_station
+{
+class MQTT;
+class FlashLog;
+
+// Radio duty cycling for battery operation. In Duty mode reports only go to the flash log, every wakeInterval the
+// radio rejoins the access point, the MQTT client reconnects, the unsent part of the log is published as backlog
+// batches and the radio is switched off again. Time spent in each radio state is tracked to estimate the current
+// draw and the energy each published sample costs.
+class RadioPower
+{
+public:
+    RadioPower(MQTT& mqtt, FlashLog& log);
+
+    void configure(const Settings& settings, uint64_t now);
+    // False while reports should only be logged and left to the next wake
+    bool live() const
+    {
+        return mode_ != Settings::RadioMode::Duty;
+    }
+    void process(uint64_t now);
+    void printStats(uint64_t now);
+
+private:
+    enum class State : uint8_t { On, Sleeping, Joining, Connecting, Publishing };
+
+    void enter(State state, uint64_t now);
+    void sleep(uint64_t now);
+    void account(uint64_t now);
+
+    // Rough CYW43439 figures at 3.3 V on top of the board's own consumption
+    static constexpr float activeMa = 45;
+    static constexpr float powerSaveMa = 4;
+    static constexpr float idleMa = 0.5f;
+    static constexpr float baseMa = 25;
+    static constexpr float volts = 3.3f;
+    static constexpr uint64_t wakeTimeout = 30000;
+
+    MQTT& mqtt_;
+    FlashLog& log_;
+    Settings::RadioMode mode_ = Settings::RadioMode::On;
+    State state_ = State::On;
+    uint32_t wakeInterval_ = 15 * 60000;
+    uint64_t stateSince_ = 0;
+    uint64_t nextWake_ = 0;
+
+    uint64_t accountedUntil_ = 0;
+    uint64_t activeMs_ = 0;
+    uint64_t powerSaveMs_ = 0;
+    uint64_t idleMs_ = 0;
+    uint32_t wakes_ = 0;
+    uint32_t failedWakes_ = 0;
+    uint32_t lastSent_ = 0;
+    uint32_t published_ = 0;
+};
+} // namespace weather_station
@@ -0,0 +1,97 @@
+#include "ReportingPolicy.h"
+
+#include <cstdlib>
+
+namespace weather_station
+{
+ReportingPolicy::ReportingPolicy()
+{
+    setDeadband(Metric::CO2, {50, 5, 100});
+    setDeadband(Metric::Temperature, {50, 0, 50});
+    setDeadband(Metric::Humidity, {200, 0, 300});
+}
+
+void ReportingPolicy::setDeadband(Metric metric, const Deadband& deadband)
+{
+    metrics_[static_cast<size_t>(metric)].deadband = deadband;
+}
+
+void ReportingPolicy::setIntervals(uint64_t minInterval, uint64_t fastInterval, uint64_t maxSilence)
+{
+    minInterval_ = minInterval;
+    fastInterval_ = fastInterval;
+    maxSilence_ = maxSilence;
+}
+
+void ReportingPolicy::update(State& state, int32_t value, uint32_t elapsed)
+{
+    if (!haveSample_) {
+        state.last = value;
+        state.reported = value;
+        return;
+    }
+    if (elapsed > 0) {
+        // Smooth the rate a bit so a single noisy sample does not flip us into fast mode
+        int32_t rate = static_cast<int64_t>(value - state.last) * 60000 / elapsed;
+        state.rate = (state.rate + rate) / 2;
+    }
+    state.last = value;
+
+    const auto& deadband = state.deadband;
+    int32_t delta = std::abs(value - state.reported);
+    if ((deadband.absolute > 0 && delta > deadband.absolute) ||
+        (deadband.relative > 0 && delta * 100 > deadband.relative * std::abs(state.reported))) {
+        triggered_ = true;
+    }
+    if (deadband.fastRate > 0 && std::abs(state.rate) > deadband.fastRate) {
+        fast_ = true;
+    }
+}
+
+void ReportingPolicy::sample(const Sensor::Measurement& measurement, uint64_t now)
+{
+    uint32_t elapsed = haveSample_ ? now - lastSample_ : 0;
+    fast_ = false;
+    update(metrics_[static_cast<size_t>(Metric::CO2)], measurement.CO2, elapsed);
+    update(metrics_[static_cast<size_t>(Metric::Temperature)], measurement.Temperature, elapsed);
+    update(metrics_[static_cast<size_t>(Metric::Humidity)], measurement.Humidity, elapsed);
+    if (!haveSample_ || fast_ || triggered_) {
+        lastMotion_ = now;
+    }
+    lastSample_ = now;
+    haveSample_ = true;
+}
+
+bool ReportingPolicy::due(uint64_t now) const
+{
+    if (!haveSample_) {
+        return false;
+    }
+    if (!haveReport_) {
+        return true;
+    }
+    auto sinceReport = now - lastReport_;
+    if (sinceReport >= maxSilence_) {
+        return true;
+    }
+    if (sinceReport < minInterval_) {
+        return false;
+    }
+    return triggered_ || (fast_ && sinceReport >= fastInterval_);
+}
+
+void ReportingPolicy::reported(uint64_t now)
+{
+    for (auto& state : metrics_) {
+        state.reported = state.last;
+    }
+    lastReport_ = now;
+    haveReport_ = true;
+    triggered_ = false;
+}
+
+bool ReportingPolicy::stable(uint64_t now) const
+{
+    return haveSample_ && !fast_ && !triggered_ && now - lastMotion_ > stableTime_;
+}
+} // namespace weather_station
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Sensor.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace weather_station
+{
+// Decides when a measurement is worth publishing. Every metric keeps a deadband around the last reported value and a
+// smoothed rate of change, so evaluating a new sample is O(1) regardless of how long the station has been running.
+class ReportingPolicy
+{
+public:
+    enum class Metric { CO2, Temperature, Humidity, Count };
+
+    // In the units of Measurement, so centi-degrees and centi-percent
+    struct Deadband
+    {
+        int32_t absolute = 0; // report once |value - reported| exceeds this
+        int32_t relative = 0; // ...or exceeds this percentage of the reported value
+        int32_t fastRate = 0; // change per minute above which the metric is considered to be moving fast
+    };
+
+    ReportingPolicy();
+
+    void setDeadband(Metric metric, const Deadband& deadband);
+    void setIntervals(uint64_t minInterval, uint64_t fastInterval, uint64_t maxSilence);
+
+    void sample(const Sensor::Measurement& measurement, uint64_t now);
+    bool due(uint64_t now) const;
+    void reported(uint64_t now);
+
+    // True when no metric has moved fast or crossed its deadband for a while
+    bool stable(uint64_t now) const;
+
+private:
+    struct State
+    {
+        Deadband deadband;
+        int32_t reported = 0;
+        int32_t last = 0;
+        int32_t rate = 0;
+    };
+
+    // elapsed is the time since the previous sample in ms
+    void update(State& state, int32_t value, uint32_t elapsed);
+
+    std::array<State, static_cast<size_t>(Metric::Count)> metrics_;
+
+    uint64_t minInterval_ = 30000;
+    uint64_t fastInterval_ = 60000;
+    uint64_t maxSilence_ = 60000 * 5;
+    uint64_t stableTime_ = 60000 * 10;
+
+    uint64_t lastSample_ = 0;
+    uint64_t lastReport_ = 0;
+    uint64_t lastMotion_ = 0;
+    bool haveSample_ = false;
+    bool haveReport_ = false;
+    bool triggered_ = false;
+    bool fast_ = false;
+};
+} // namespace weather_station
@@ -1,14 +1,25 @@
 #include "SCD.h"
+#include "FaultInjector.h"
+#include "I2CBus.h"
 
 #include "ino_compat.h"
+#include "embedded-i2c-scd4x/sensirion_common.h"
 #include "embedded-i2c-scd4x/sensirion_i2c_hal.h"
 #include "embedded-i2c-scd4x/scd4x_i2c.h"
-#include "hardware/i2c.h"
 
 #include <iostream>
 
 namespace weather_station
 {
+namespace
+{
+constexpr uint8_t address = 0x62;
+constexpr uint16_t getDataReady = 0xE4B8;
+constexpr uint16_t readMeasurement = 0xEC05;
+// Execution time of both commands
+constexpr uint32_t commandDelayUs = 1000;
+} // namespace
+
 int16_t checkError(uint16_t err, std::string_view where)
 {
     if (err != 0) {
@@ -16,8 +27,10 @@ int16_t checkError(uint16_t err, std::string_view where)
     }
     return err;
 }
-SCD::SCD()
+SCD::SCD(uint8_t bus)
+    : bus_(bus)
 {
+    sensirion_i2c_hal_select_bus(bus_);
     sensirion_i2c_hal_init();
 
     // Clean up potential SCD40 states
@@ -37,52 +50,174 @@ SCD::SCD()
     //checkError(scd4x_perform_self_test(&status), "self_test");
     //std::cout << "Self test status: " << status << "\n";
 
-    checkError(scd4x_start_periodic_measurement(), "scd4x_start_periodic_measurement");
+    startMeasurement();
     lastMeasure_ = millis() + 5000;
 }
 
+void SCD::startMeasurement()
+{
+    if (mode_ == Mode::LowPower) {
+        // A new sample every ~30 seconds, no point in polling the data ready flag every second
+        checkError(scd4x_start_low_power_periodic_measurement(), "scd4x_start_low_power_periodic_measurement");
+        pollInterval_ = 5000;
+    } else {
+        checkError(scd4x_start_periodic_measurement(), "scd4x_start_periodic_measurement");
+        pollInterval_ = 1000;
+    }
+    if (pollOverride_ != 0) {
+        pollInterval_ = pollOverride_;
+    }
+}
+
+void SCD::setPollInterval(uint64_t ms)
+{
+    pollOverride_ = ms;
+    if (ms != 0) {
+        pollInterval_ = ms;
+    } else {
+        pollInterval_ = mode_ == Mode::LowPower ? 5000 : 1000;
+    }
+}
+
+void SCD::clockChanged()
+{
+    I2CBus::bus(bus_).clockChanged();
+}
+
+void SCD::setMode(Mode mode)
+{
+    if (mode == mode_) {
+        return;
+    }
+    std::cout << "SCD " << int(bus_) << " switching to " << (mode == Mode::LowPower ? "low power" : "periodic")
+              << " mode\n";
+    mode_ = mode;
+    // Blocks for 500ms inside the driver, but mode changes are rare
+    sensirion_i2c_hal_select_bus(bus_);
+    checkError(scd4x_stop_periodic_measurement(), "scd4x_stop_periodic_measurement");
+    startMeasurement();
+    lastMeasure_ = millis();
+}
+
 bool SCD::process()
 {
     auto now = millis();
-    if (lastMeasure_ > now || now - lastMeasure_ < 1000) {
+    if (pollState_ == PollState::Idle) {
+        if (lastMeasure_ > now || now - lastMeasure_ < pollInterval_) {
+            return false;
+        }
+        lastMeasure_ = now;
+        submit(getDataReady, 1, PollState::WaitReady);
         return false;
     }
-    lastMeasure_ = now;
-
-    bool data_ready_flag = false;
-    auto err = scd4x_get_data_ready_flag(&data_ready_flag);
-    if (err == -123) {
-        ++numRestarts_;
-        std::cout << "Restart " << numRestarts_ << "\n";
-        sleep_ms(100);
-        checkError(scd4x_power_down(), "power_down");
-        sleep_ms(1000);
-        checkError(scd4x_wake_up(), "scd4x_wake_up");
-        checkError(scd4x_stop_periodic_measurement(), "scd4x_stop_periodic_measurement");
-        sleep_ms(600);
-        checkError(scd4x_reinit(), "scd4x_reinit");
-        checkError(scd4x_start_periodic_measurement(), "scd4x_start_periodic_measurement");
-        lastMeasure_ = now + 5000;
+    if (!done_) {
+        return false;
+    }
+
+    bool ready = complete(now);
+    if (ready && restartedAt_ != 0) {
+        stats_.recoveryMs.add(now - restartedAt_);
+        restartedAt_ = 0;
+    }
+    return ready;
+}
+
+void SCD::submit(uint16_t command, uint16_t responseWords, PollState next)
+{
+    command_ = {static_cast<uint8_t>(command >> 8), static_cast<uint8_t>(command)};
+    responseWords_ = responseWords;
+    I2CBus::Transaction transaction;
+    transaction.address = address;
+    transaction.tx = command_.data();
+    transaction.txLen = command_.size();
+    transaction.rx = response_.data();
+    transaction.rxLen = responseWords * 3;
+    transaction.delayUs = commandDelayUs;
+    transaction.done = [](void* arg, int result) {
+        auto scd = static_cast<SCD*>(arg);
+        scd->result_ = result;
+        scd->done_ = true;
+    };
+    transaction.arg = this;
+    done_ = false;
+    submittedAt_ = time_us_64();
+    if (!I2CBus::bus(bus_).submit(transaction)) {
+        ++stats_.errors;
+        pollState_ = PollState::Idle;
+        return;
+    }
+    pollState_ = next;
+}
+
+void SCD::printStats() const
+{
+    const auto& s = stats_;
+    std::cout << "SCD " << int(bus_) << ": " << s.pollUs.count() << " polls, latency p50 " << s.pollUs.percentile(50)
+              << " us, p99 " << s.pollUs.percentile(99) << " us, max " << s.pollUs.max() << " us; " << numRestarts_
+              << " restarts, recovery avg " << s.recoveryMs.mean() << " ms, max " << s.recoveryMs.max() << " ms; "
+              << s.errors << " errors\n";
+}
+
+bool SCD::complete(uint64_t now)
+{
+    stats_.pollUs.add(time_us_64() - submittedAt_);
+    auto state = pollState_;
+    pollState_ = PollState::Idle;
+
+    auto err = FaultInjector::fail(FaultInjector::Fault::I2cError) ? I2CBus::nackError : int(result_);
+    if (err == I2CBus::nackError) {
+        restart(now);
         return false;
     } else if (err != 0) {
         std::cout << "Unknown error\n";
+        ++stats_.errors;
         return false;
     }
-    if (!data_ready_flag) {
-        return false;
+    std::array<uint16_t, 3> words = {};
+    for (uint16_t i = 0; i < responseWords_; ++i) {
+        const auto* word = &response_[i * 3];
+        if (sensirion_common_generate_crc(word, 2) != word[2]) {
+            std::cout << "SCD CRC mismatch\n";
+            ++stats_.errors;
+            return false;
+        }
+        words[i] = (word[0] << 8) | word[1];
     }
 
-    int32_t temperature = 0;
-    int32_t humidity = 0;
-    if (checkError(scd4x_read_measurement(&measurement_.CO2, &temperature, &humidity), "scd4x_read_measurement")) {
-        return false;
-    }
-    if (measurement_.CO2 == 0) {
-        std::cout << "Invalid sample detected, skipping.\n";
+    if (state == PollState::WaitReady) {
+        // Data is ready if any of the 11 least significant bits is set
+        if (words[0] & 0x07FF) {
+            submit(readMeasurement, 3, PollState::WaitMeasurement);
+        }
         return false;
     }
-    measurement_.Temperature = temperature / 1000.0f;
-    measurement_.Humidity = humidity / 1000.0f;
+
+    // Zero CO2 samples after a restart are left to the range filter
+    measurement_.CO2 = words[0];
+    // Same conversions as scd4x_read_measurement(), scaled to centi-degrees and centi-percent instead of milli
+    measurement_.Temperature = ((4375 * int32_t(words[1])) >> 14) - 4500;
+    measurement_.Humidity = (625 * int32_t(words[2])) >> 12;
+    measurement_.Valid = Measurement::HasTemperature | Measurement::HasHumidity | Measurement::HasCO2;
+    time_ = micros();
     return true;
 }
-} // namespace weather_station
\ No newline at end of file
+
+void SCD::restart(uint64_t now)
+{
+    ++numRestarts_;
+    if (restartedAt_ == 0) {
+        restartedAt_ = now;
+    }
+    std::cout << "Restart " << numRestarts_ << "\n";
+    sensirion_i2c_hal_select_bus(bus_);
+    sleep_ms(100);
+    checkError(scd4x_power_down(), "power_down");
+    sleep_ms(1000);
+    checkError(scd4x_wake_up(), "scd4x_wake_up");
+    checkError(scd4x_stop_periodic_measurement(), "scd4x_stop_periodic_measurement");
+    sleep_ms(600);
+    checkError(scd4x_reinit(), "scd4x_reinit");
+    startMeasurement();
+    lastMeasure_ = now + 5000;
+}
+} // namespace weather_station
@@ -1,16 +1,64 @@
 #pragma once
 #include "Sensor.h"
+#include "Statistics.h"
+
+#include <array>
 
 namespace weather_station
 {
 class SCD: public Sensor
 {
 public:
-    SCD();
+    enum class Mode { Periodic, LowPower };
+
+    // bus is the I2C controller the sensor is wired to
+    explicit SCD(uint8_t bus);
     bool process() override;
 
+    void setMode(Mode mode);
+    Mode mode() const
+    {
+        return mode_;
+    }
+    // 0 goes back to the interval matching the mode
+    void setPollInterval(uint64_t ms);
+    // I2C is clocked from clk_sys, its divider has to follow clock changes
+    void clockChanged() override;
+    // Bus latency per poll transaction and how long restarts took to yield a sample again
+    void printStats() const;
+
 private:
+    // Polls run on the shared bus without blocking: data ready, then the measurement if there is one
+    enum class PollState { Idle, WaitReady, WaitMeasurement };
+
+    void startMeasurement();
+    void submit(uint16_t command, uint16_t responseWords, PollState next);
+    bool complete(uint64_t now);
+    void restart(uint64_t now);
+
+    struct Stats
+    {
+        Histogram pollUs;
+        RunningStats recoveryMs;
+        uint32_t errors = 0;
+    };
+
+    const uint8_t bus_;
+    Mode mode_ = Mode::Periodic;
+    uint64_t pollInterval_ = 1000;
+    uint64_t pollOverride_ = 0;
     uint64_t lastMeasure_ = 0;
     int numRestarts_ = 0;
+    uint64_t restartedAt_ = 0;
+    Stats stats_;
+
+    PollState pollState_ = PollState::Idle;
+    std::array<uint8_t, 2> command_ = {};
+    // Up to three words, each followed by its CRC
+    std::array<uint8_t, 9> response_ = {};
+    uint16_t responseWords_ = 0;
+    uint64_t submittedAt_ = 0;
+    volatile bool done_ = false;
+    volatile int result_ = 0;
 };
 } // namespace weather_station
@@ -0,0 +1,204 @@
+#include "ScdEmulator.h"
+
+#include <pico/stdlib.h>
+
+#include <cmath>
+#include <iostream>
+
+namespace weather_station
+{
+namespace
+{
+constexpr uint16_t startPeriodic = 0x21B1;
+constexpr uint16_t startLowPower = 0x21AC;
+constexpr uint16_t stopPeriodic = 0x3F86;
+constexpr uint16_t readMeasurement = 0xEC05;
+constexpr uint16_t getDataReady = 0xE4B8;
+constexpr uint16_t getSerialNumber = 0x3682;
+constexpr uint16_t reinit = 0x3646;
+constexpr uint16_t powerDown = 0x36E0;
+constexpr uint16_t wakeUp = 0x36F6;
+constexpr uint16_t selfTest = 0x3639;
+
+struct ScriptStep
+{
+    uint32_t atS;
+    ScdEmulator::Fault fault;
+    uint32_t count;
+};
+
+// Repeats every scriptPeriodS seconds after boot
+constexpr ScriptStep script[] = {
+    {120, ScdEmulator::Fault::Nack, 2},
+    {240, ScdEmulator::Fault::StuckNotReady, 20},
+    {360, ScdEmulator::Fault::ZeroCo2, 2},
+    {480, ScdEmulator::Fault::BadCrc, 1},
+};
+constexpr uint32_t scriptPeriodS = 600;
+
+uint8_t crc8(uint16_t word)
+{
+    uint8_t crc = 0xFF;
+    for (uint8_t byte : {static_cast<uint8_t>(word >> 8), static_cast<uint8_t>(word)}) {
+        crc ^= byte;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+    }
+    return crc;
+}
+} // namespace
+
+ScdEmulator& ScdEmulator::instance(unsigned bus)
+{
+    static std::array<ScdEmulator, I2CBus::busCount> emulators;
+    return emulators[bus];
+}
+
+void ScdEmulator::inject(Fault fault, uint32_t count)
+{
+    std::cout << "SCD emulator: injecting fault " << static_cast<int>(fault) << " x" << count << "\n";
+    fault_ = fault;
+    faultCount_ = count;
+}
+
+bool ScdEmulator::consume(Fault fault)
+{
+    if (fault_ != fault || faultCount_ == 0) {
+        return false;
+    }
+    if (--faultCount_ == 0) {
+        fault_ = Fault::None;
+    }
+    return true;
+}
+
+void ScdEmulator::runScript(uint64_t now)
+{
+    if (scriptStart_ == 0) {
+        scriptStart_ = now;
+    }
+    const auto& step = script[scriptStep_];
+    // The start of the next round lies ahead of the last step of this one
+    if (now >= scriptStart_ + step.atS * 1000000ULL) {
+        inject(step.fault, step.count);
+        if (++scriptStep_ == std::size(script)) {
+            scriptStep_ = 0;
+            scriptStart_ += scriptPeriodS * 1000000ULL;
+        }
+    }
+}
+
+void ScdEmulator::startMeasuring(State state, uint64_t now)
+{
+    state_ = state;
+    interval_ = (state == State::LowPower ? 30 : 5) * 1000000ULL;
+    nextSample_ = now + interval_;
+    ready_ = false;
+}
+
+void ScdEmulator::updateSample(uint64_t now)
+{
+    if ((state_ != State::Periodic && state_ != State::LowPower) || now < nextSample_) {
+        return;
+    }
+    // Catch up on samples nobody read, only the newest one is kept like on the sensor
+    while (nextSample_ <= now) {
+        nextSample_ += interval_;
+    }
+    auto t = now / 1e6f;
+    auto co2 = 700 + 300 * std::sin(t * 2 * 3.14159f / 1800) + 15 * std::sin(t * 0.7f);
+    auto temperature = 22 + 2 * std::sin(t * 2 * 3.14159f / 3600);
+    auto humidity = 45 + 8 * std::sin(t * 2 * 3.14159f / 2700);
+    sample_[0] = consume(Fault::ZeroCo2) ? 0 : static_cast<uint16_t>(co2);
+    // Raw encodings from the datasheet: T = -45 + 175 * raw / 65535, RH = 100 * raw / 65535
+    sample_[1] = static_cast<uint16_t>((temperature + 45) * 65535 / 175);
+    sample_[2] = static_cast<uint16_t>(humidity * 65535 / 100);
+    ready_ = true;
+}
+
+void ScdEmulator::command(uint16_t code, uint64_t now)
+{
+    responseWords_ = 0;
+    switch (code) {
+        case startPeriodic:
+            startMeasuring(State::Periodic, now);
+            break;
+        case startLowPower:
+            startMeasuring(State::LowPower, now);
+            break;
+        case stopPeriodic:
+        case reinit:
+            state_ = State::Idle;
+            ready_ = false;
+            break;
+        case powerDown:
+            state_ = State::Sleeping;
+            ready_ = false;
+            break;
+        case wakeUp:
+            // Already awake
+            break;
+        case readMeasurement:
+            response_ = sample_;
+            responseWords_ = 3;
+            ready_ = false;
+            break;
+        case getDataReady:
+            // The low 11 bits are non-zero when a sample is waiting
+            response_[0] = ready_ && !consume(Fault::StuckNotReady) ? 0x8006 : 0x8000;
+            responseWords_ = 1;
+            break;
+        case getSerialNumber:
+            response_ = {0x5CD4, 0x0E4D, 0x0001};
+            responseWords_ = 3;
+            break;
+        case selfTest:
+            response_[0] = 0;
+            responseWords_ = 1;
+            break;
+        default:
+            std::cout << "SCD emulator: unknown command 0x" << std::hex << code << std::dec << "\n";
+            break;
+    }
+}
+
+int8_t ScdEmulator::write(uint8_t address, const uint8_t* data, uint16_t count)
+{
+    auto now = time_us_64();
+    runScript(now);
+    updateSample(now);
+    if (address != ScdEmulator::address || count < 2) {
+        return nackError;
+    }
+    uint16_t code = data[0] << 8 | data[1];
+    if (state_ == State::Sleeping) {
+        // A sleeping sensor does not acknowledge anything, not even the wake up command itself
+        if (code == wakeUp) {
+            state_ = State::Idle;
+        }
+        return nackError;
+    }
+    if (consume(Fault::Nack)) {
+        return nackError;
+    }
+    command(code, now);
+    return 0;
+}
+
+int8_t ScdEmulator::read(uint8_t address, uint8_t* data, uint16_t count)
+{
+    if (address != ScdEmulator::address || state_ == State::Sleeping || count > responseWords_ * 3) {
+        return nackError;
+    }
+    bool corrupt = consume(Fault::BadCrc);
+    for (uint16_t i = 0; i + 3 <= count; i += 3) {
+        auto word = response_[i / 3];
+        data[i] = word >> 8;
+        data[i + 1] = word;
+        data[i + 2] = crc8(word) ^ (corrupt ? 0x5A : 0);
+    }
+    responseWords_ = 0;
+    return 0;
+}
+} // namespace weather_station
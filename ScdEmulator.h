@@ -0,0 +1,56 @@
+#pragma once
+
+#include "I2CBus.h"
+
+#include <array>
+#include <cstdint>
+
+namespace weather_station
+{
+// Behavioural SCD4x model that I2CBus talks to instead of the controller with -DSCD_EMULATOR=1, so the SCD driver and
+// its recovery logic run without a sensor attached. It answers the commands the
+// driver uses with CRC-framed words, produces a sample every 5 s (30 s in low power mode) following slow CO2,
+// temperature and humidity waves, and replays a fault script: NACKs, a stuck data-ready flag, zero CO2 samples and
+// corrupted CRCs at fixed points of every 10 minutes.
+class ScdEmulator
+{
+public:
+    enum class Fault : uint8_t { None, Nack, StuckNotReady, ZeroCo2, BadCrc };
+
+    // One emulated sensor per I2C controller
+    static ScdEmulator& instance(unsigned bus);
+
+    // The next count transactions (Nack, BadCrc), data-ready polls (StuckNotReady) or samples (ZeroCo2) fail
+    void inject(Fault fault, uint32_t count);
+
+    int8_t write(uint8_t address, const uint8_t* data, uint16_t count);
+    int8_t read(uint8_t address, uint8_t* data, uint16_t count);
+
+    static constexpr int8_t nackError = I2CBus::nackError;
+
+private:
+    enum class State { Idle, Periodic, LowPower, Sleeping };
+
+    static constexpr uint8_t address = 0x62;
+
+    void command(uint16_t code, uint64_t now);
+    void startMeasuring(State state, uint64_t now);
+    void updateSample(uint64_t now);
+    void runScript(uint64_t now);
+    bool consume(Fault fault);
+
+    State state_ = State::Idle;
+    uint64_t nextSample_ = 0;
+    uint64_t interval_ = 0;
+    bool ready_ = false;
+    std::array<uint16_t, 3> sample_ = {};
+
+    std::array<uint16_t, 3> response_ = {};
+    uint8_t responseWords_ = 0;
+
+    Fault fault_ = Fault::None;
+    uint32_t faultCount_ = 0;
+    uint32_t scriptStep_ = 0;
+    uint64_t scriptStart_ = 0;
+};
+} // namespace weather_station
@@ -0,0 +1,63 @@
+#include "I2CBus.h"
+
+#include "embedded-i2c-scd4x/sensirion_i2c_hal.h"
+
+#include <pico/stdlib.h>
+
+#include <iostream>
+
+// The Sensirion driver's bus HAL on top of I2CBus. The driver calls are blocking, they run the bus until their
+// transfer is done, so transactions that other drivers queued in the meantime go out as well. Drivers of several
+// SCD4x select their controller before every batch of driver calls.
+using weather_station::I2CBus;
+
+namespace
+{
+unsigned selected = 0;
+} // namespace
+
+extern "C" {
+void sensirion_i2c_hal_init(void)
+{
+#ifdef SCD_EMULATOR
+    std::cout << "SCD emulator in place of the I2C bus\n";
+#endif
+    I2CBus::bus(selected);
+}
+
+void sensirion_i2c_hal_free(void)
+{
+}
+
+int16_t sensirion_i2c_hal_select_bus(uint8_t bus_idx)
+{
+    if (bus_idx >= I2CBus::busCount) {
+        return -1;
+    }
+    selected = bus_idx;
+    return 0;
+}
+
+int8_t sensirion_i2c_hal_read(uint8_t address, uint8_t* data, uint16_t count)
+{
+    I2CBus::Transaction transaction;
+    transaction.address = address;
+    transaction.rx = data;
+    transaction.rxLen = count;
+    return static_cast<int8_t>(I2CBus::bus(selected).transfer(transaction));
+}
+
+int8_t sensirion_i2c_hal_write(uint8_t address, const uint8_t* data, uint16_t count)
+{
+    I2CBus::Transaction transaction;
+    transaction.address = address;
+    transaction.tx = data;
+    transaction.txLen = count;
+    return static_cast<int8_t>(I2CBus::bus(selected).transfer(transaction));
+}
+
+void sensirion_i2c_hal_sleep_usec(uint32_t useconds)
+{
+    sleep_us(useconds);
+}
+}
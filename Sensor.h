@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Measurement.h"
+
 #include <stdint.h>
 
 namespace weather_station
@@ -7,20 +9,35 @@ namespace weather_station
 class Sensor
 {
 public:
+    virtual ~Sensor() = default;
     virtual bool process() = 0;
-    struct Measurement
+    // Called after clk_sys has been changed, for sensors whose peripherals are clocked from it
+    virtual void clockChanged()
     {
-        float Temperature = 0;
-        float Humidity = 0;
-        uint16_t CO2 = 0;
-    };
+    }
+    using Measurement = weather_station::Measurement;
 
     Measurement& GetMeasurement()
     {
         return measurement_;
     }
+    // time_us_64() when the sample was taken, Clock maps it to UTC
+    uint64_t GetTime() const
+    {
+        return time_;
+    }
 
 protected:
     Measurement measurement_;
+    uint64_t time_ = 0;
+};
+
+// Latest sample of one sensor of the topology, published on its own topic
+struct SensorReading
+{
+    const char* id = nullptr;
+    Sensor::Measurement measurement;
+    // 0 until the sensor has delivered a sample
+    uint64_t time = 0;
 };
 } // namespace weather_station
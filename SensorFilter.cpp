@@ -0,0 +1,120 @@
+#include "SensorFilter.h"
+
+#include <iostream>
+
+namespace weather_station
+{
+namespace
+{
+using namespace filter;
+
+// Temperature and humidity thresholds are in centi-units like the samples
+
+// Whole degrees and percent, a glitching bit shows as a jump the median hides
+struct Dht11Filters
+{
+    using Temperature = FilterPipeline<int32_t, Range<int32_t, 0, 5000>, Median<int32_t, 3>, RateLimit<int32_t, 200>>;
+    using Humidity = FilterPipeline<int32_t, Range<int32_t, 500, 9500>, Median<int32_t, 3>, RateLimit<int32_t, 500>>;
+    using CO2 = FilterPipeline<int32_t>;
+};
+
+struct Dht22Filters
+{
+    using Temperature =
+        FilterPipeline<int32_t, Range<int32_t, -4000, 8000>, Hampel<int32_t, 5, 30, 100>, Ema<int32_t, 50>>;
+    using Humidity = FilterPipeline<int32_t, Range<int32_t, 0, 10000>, Hampel<int32_t, 5, 30, 300>, Ema<int32_t, 50>>;
+    using CO2 = FilterPipeline<int32_t>;
+};
+
+// Zero CO2 right after a restart is dropped by the range, single spikes by the Hampel stage
+struct Scd4xFilters
+{
+    using Temperature =
+        FilterPipeline<int32_t, Range<int32_t, -1000, 6000>, Hampel<int32_t, 7, 30, 100>, Ema<int32_t, 50>>;
+    using Humidity = FilterPipeline<int32_t, Range<int32_t, 0, 10000>, Hampel<int32_t, 7, 30, 300>, Ema<int32_t, 50>>;
+    using CO2 = FilterPipeline<int32_t, Range<int32_t, 250, 40000>, Hampel<int32_t, 7, 30, 50>, RateLimit<int32_t, 500>>;
+};
+
+template <typename Pipeline>
+uint32_t rejectedBy(const Pipeline& pipeline)
+{
+    uint32_t total = 0;
+    for (size_t stage = 0; stage < Pipeline::stageCount; ++stage) {
+        total += pipeline.rejected(stage);
+    }
+    return total;
+}
+
+template <typename Pipeline>
+void printPipeline(const char* id, const char* metric, const Pipeline& pipeline)
+{
+    if (Pipeline::stageCount == 0) {
+        return;
+    }
+    std::cout << "Filter " << id << " " << metric << " rejected:";
+    for (size_t stage = 0; stage < Pipeline::stageCount; ++stage) {
+        std::cout << " " << Pipeline::stageName(stage) << " " << pipeline.rejected(stage);
+    }
+    std::cout << "\n";
+}
+
+template <typename Filters>
+class Filter: public SensorFilter
+{
+public:
+    bool apply(Sensor::Measurement& measurement) override
+    {
+        auto temperature = run(temperature_, measurement, Measurement::HasTemperature, measurement.Temperature);
+        auto humidity = run(humidity_, measurement, Measurement::HasHumidity, measurement.Humidity);
+        auto co2 = run(co2_, measurement, Measurement::HasCO2, measurement.CO2);
+        if (!temperature || !humidity || !co2) {
+            return false;
+        }
+        measurement.Temperature = *temperature;
+        measurement.Humidity = *humidity;
+        measurement.CO2 = *co2;
+        return true;
+    }
+
+    uint32_t rejected() const override
+    {
+        return rejectedBy(temperature_) + rejectedBy(humidity_) + rejectedBy(co2_);
+    }
+
+    void printStats(const char* id) const override
+    {
+        printPipeline(id, "temperature", temperature_);
+        printPipeline(id, "humidity", humidity_);
+        printPipeline(id, "co2", co2_);
+    }
+
+private:
+    // Metrics the sample does not carry pass through untouched
+    template <typename Pipeline>
+    static std::optional<int32_t> run(Pipeline& pipeline, const Measurement& measurement, uint8_t metric, int32_t value)
+    {
+        if (!measurement.has(metric)) {
+            return value;
+        }
+        return pipeline(value);
+    }
+
+    typename Filters::Temperature temperature_;
+    typename Filters::Humidity humidity_;
+    typename Filters::CO2 co2_;
+};
+} // namespace
+
+std::unique_ptr<SensorFilter> SensorFilter::create(SensorConfig::Kind kind)
+{
+    switch (kind) {
+        case SensorConfig::Kind::Dht11:
+            return std::make_unique<Filter<Dht11Filters>>();
+        case SensorConfig::Kind::Dht22:
+            return std::make_unique<Filter<Dht22Filters>>();
+        case SensorConfig::Kind::Scd4x:
+            return std::make_unique<Filter<Scd4xFilters>>();
+    }
+    return nullptr;
+}
+} // namespace weather_station
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Filter.h"
+#include "Sensor.h"
+#include "Topology.h"
+
+#include <memory>
+
+namespace weather_station
+{
+// Noise handling of one sensor: a FilterPipeline per metric, chosen by the sensor kind in SensorFilter.cpp
+class SensorFilter
+{
+public:
+    virtual ~SensorFilter() = default;
+
+    static std::unique_ptr<SensorFilter> create(SensorConfig::Kind kind);
+
+    // Filters every valid metric of the sample in place, false if a stage rejected any of them. All of them go through
+    // their pipeline either way, so the windows stay in step.
+    virtual bool apply(Sensor::Measurement& measurement) = 0;
+    virtual uint32_t rejected() const = 0;
+    // Rejections per metric and stage
+    virtual void printStats(const char* id) const = 0;
+};
+} // namespace weather_station
@@ -0,0 +1,165 @@
+#include "Settings.h"
+
+#include <charconv>
+#include <sstream>
+
+namespace weather_station
+{
+namespace
+{
+bool parseNumber(std::string_view value, uint32_t min, uint32_t max, uint32_t& out)
+{
+    uint32_t parsed = 0;
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+    if (ec != std::errc{} || end != value.data() + value.size() || parsed < min || parsed > max) {
+        return false;
+    }
+    out = parsed;
+    return true;
+}
+
+bool parseScdMode(std::string_view value, Settings::ScdMode& out)
+{
+    if (value == "auto") {
+        out = Settings::ScdMode::Auto;
+    } else if (value == "periodic") {
+        out = Settings::ScdMode::Periodic;
+    } else if (value == "lowpower") {
+        out = Settings::ScdMode::LowPower;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseRadioMode(std::string_view value, Settings::RadioMode& out)
+{
+    if (value == "on") {
+        out = Settings::RadioMode::On;
+    } else if (value == "pm") {
+        out = Settings::RadioMode::PowerSave;
+    } else if (value == "duty") {
+        out = Settings::RadioMode::Duty;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* radioModeName(Settings::RadioMode mode)
+{
+    switch (mode) {
+        case Settings::RadioMode::PowerSave:
+            return "pm";
+        case Settings::RadioMode::Duty:
+            return "duty";
+        default:
+            return "on";
+    }
+}
+
+bool parsePowerMode(std::string_view value, Settings::PowerMode& out)
+{
+    if (value == "normal") {
+        out = Settings::PowerMode::Normal;
+    } else if (value == "low") {
+        out = Settings::PowerMode::Low;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* scdModeName(Settings::ScdMode mode)
+{
+    switch (mode) {
+        case Settings::ScdMode::Periodic:
+            return "periodic";
+        case Settings::ScdMode::LowPower:
+            return "lowpower";
+        default:
+            return "auto";
+    }
+}
+} // namespace
+
+bool Settings::apply(std::string_view command, std::string& response)
+{
+    Settings updated = *this;
+    size_t pos = 0;
+    bool changed = false;
+    while (pos < command.size()) {
+        auto end = command.find_first_of(" ;\n", pos);
+        if (end == std::string_view::npos) {
+            end = command.size();
+        }
+        auto token = command.substr(pos, end - pos);
+        pos = end + 1;
+        if (token.empty() || token == "get") {
+            continue;
+        }
+        auto eq = token.find('=');
+        if (eq == std::string_view::npos) {
+            response = "error " + std::string(token) + ": expected key=value";
+            return false;
+        }
+        auto key = token.substr(0, eq);
+        auto value = token.substr(eq + 1);
+        uint32_t number = 0;
+        bool ok = false;
+        if (key == "report_min") {
+            ok = parseNumber(value, 1000, 3600000, updated.reportMin);
+        } else if (key == "report_fast") {
+            ok = parseNumber(value, 1000, 3600000, updated.reportFast);
+        } else if (key == "report_max") {
+            ok = parseNumber(value, 10000, 86400000, updated.reportMax);
+        } else if (key == "scd_poll") {
+            ok = parseNumber(value, 0, 60000, updated.scdPoll) && (updated.scdPoll == 0 || updated.scdPoll >= 1000);
+        } else if (key == "scd_mode") {
+            ok = parseScdMode(value, updated.scdMode);
+        } else if (key == "sync") {
+            ok = parseNumber(value, 100, 60000, updated.displaySync);
+        } else if (key == "brightness") {
+            ok = parseNumber(value, 0, 100, number);
+            updated.brightness = number;
+        } else if (key == "qos") {
+            ok = parseNumber(value, 0, 2, number);
+            updated.qos = number;
+        } else if (key == "radio") {
+            ok = parseRadioMode(value, updated.radio);
+        } else if (key == "wake") {
+            ok = parseNumber(value, 60000, 86400000, updated.wakeInterval);
+        } else if (key == "power") {
+            ok = parsePowerMode(value, updated.power);
+        } else if (key == "display_timeout") {
+            ok = parseNumber(value, 0, 86400000, updated.displayTimeout);
+        } else {
+            response = "error " + std::string(key) + ": unknown setting";
+            return false;
+        }
+        if (!ok) {
+            response = "error " + std::string(key) + ": invalid value " + std::string(value);
+            return false;
+        }
+        changed = true;
+    }
+    if (updated.reportMin > updated.reportFast || updated.reportFast > updated.reportMax) {
+        response = "error report_min <= report_fast <= report_max required";
+        return false;
+    }
+    *this = updated;
+    response = "ok " + describe();
+    return changed;
+}
+
+std::string Settings::describe() const
+{
+    std::stringstream ss;
+    ss << "report_min=" << reportMin << " report_fast=" << reportFast << " report_max=" << reportMax
+       << " scd_poll=" << scdPoll << " scd_mode=" << scdModeName(scdMode) << " sync=" << displaySync
+       << " brightness=" << static_cast<int>(brightness) << " qos=" << static_cast<int>(qos)
+       << " radio=" << radioModeName(radio) << " wake=" << wakeInterval
+       << " power=" << (power == PowerMode::Low ? "low" : "normal") << " display_timeout=" << displayTimeout;
+    return ss.str();
+}
+} // namespace weather_station
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace weather_station
+{
+// Runtime tunables, changed over the MQTT command channel
+struct Settings
+{
+    enum class ScdMode : uint8_t { Auto, Periodic, LowPower };
+    // On: associated at full power, PowerSave: associated with CYW43 power management, Duty: radio off between
+    // batched uploads every wakeInterval
+    enum class RadioMode : uint8_t { On, PowerSave, Duty };
+    // Low: the main loop sleeps between ticks at a reduced clock and the display turns off when left alone
+    enum class PowerMode : uint8_t { Normal, Low };
+
+    uint32_t reportMin = 30000;
+    uint32_t reportFast = 60000;
+    uint32_t reportMax = 60000 * 5;
+    uint32_t scdPoll = 0; // 0 picks the interval matching the SCD mode
+    ScdMode scdMode = ScdMode::Auto;
+    uint32_t displaySync = 2000;
+    uint8_t brightness = 50;
+    uint8_t qos = 1;
+    RadioMode radio = RadioMode::On;
+    uint32_t wakeInterval = 15 * 60000;
+    PowerMode power = PowerMode::Normal;
+    uint32_t displayTimeout = 60000; // 0 keeps the display on in low power mode
+
+    // Applies "key=value" pairs separated by spaces, all or nothing. "get" only reports the current values.
+    // response is what to acknowledge the command with.
+    bool apply(std::string_view command, std::string& response);
+    std::string describe() const;
+};
+} // namespace weather_station
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace weather_station
+{
+// Streaming min/max/mean/variance over a window of samples (Welford's algorithm), constant memory per metric
+class RunningStats
+{
+public:
+    void add(float value)
+    {
+        ++count_;
+        float delta = value - mean_;
+        mean_ += delta / count_;
+        m2_ += delta * (value - mean_);
+        if (value < min_) {
+            min_ = value;
+        }
+        if (value > max_) {
+            max_ = value;
+        }
+        last_ = value;
+    }
+
+    void reset()
+    {
+        *this = RunningStats{};
+    }
+
+    uint32_t count() const
+    {
+        return count_;
+    }
+    float min() const
+    {
+        return count_ ? min_ : 0;
+    }
+    float max() const
+    {
+        return count_ ? max_ : 0;
+    }
+    float mean() const
+    {
+        return mean_;
+    }
+    float variance() const
+    {
+        return count_ > 1 ? m2_ / (count_ - 1) : 0;
+    }
+    float stddev() const
+    {
+        return std::sqrt(variance());
+    }
+    float last() const
+    {
+        return last_;
+    }
+
+private:
+    uint32_t count_ = 0;
+    float mean_ = 0;
+    float m2_ = 0;
+    float min_ = std::numeric_limits<float>::max();
+    float max_ = std::numeric_limits<float>::lowest();
+    float last_ = 0;
+};
+
+// The same for integer samples, e.g. centi-degrees. Adding a sample is integer only, the sums are exact so the
+// variance is taken from them when the window is reported instead of updating a running mean per sample.
+class SampleStats
+{
+public:
+    void add(int32_t value)
+    {
+        ++count_;
+        sum_ += value;
+        sumSquares_ += static_cast<int64_t>(value) * value;
+        if (value < min_) {
+            min_ = value;
+        }
+        if (value > max_) {
+            max_ = value;
+        }
+        last_ = value;
+    }
+
+    void reset()
+    {
+        *this = SampleStats{};
+    }
+
+    uint32_t count() const
+    {
+        return count_;
+    }
+    int32_t min() const
+    {
+        return count_ ? min_ : 0;
+    }
+    int32_t max() const
+    {
+        return count_ ? max_ : 0;
+    }
+    // Rounded to the unit of the samples
+    int32_t mean() const
+    {
+        if (count_ == 0) {
+            return 0;
+        }
+        int64_t half = sum_ < 0 ? -int64_t(count_ / 2) : count_ / 2;
+        return static_cast<int32_t>((sum_ + half) / count_);
+    }
+    int32_t stddev() const
+    {
+        if (count_ < 2) {
+            return 0;
+        }
+        // n * sum(x^2) - sum(x)^2 fits easily for the window sizes and ranges of the sensors
+        int64_t spread = count_ * sumSquares_ - sum_ * sum_;
+        return static_cast<int32_t>(std::lround(std::sqrt(static_cast<float>(spread) / count_ / (count_ - 1))));
+    }
+    int32_t last() const
+    {
+        return last_;
+    }
+
+private:
+    uint32_t count_ = 0;
+    int64_t sum_ = 0;
+    int64_t sumSquares_ = 0;
+    int32_t min_ = std::numeric_limits<int32_t>::max();
+    int32_t max_ = std::numeric_limits<int32_t>::lowest();
+    int32_t last_ = 0;
+};
+
+// Log2-bucketed histogram for latencies, bucket k counts values in [2^k, 2^(k+1)). Percentiles are reported as the
+// upper bound of the bucket they fall in, so they are accurate to a factor of two at worst.
+class Histogram
+{
+public:
+    void add(uint32_t value)
+    {
+        int bucket = 0;
+        while (bucket < static_cast<int>(buckets_.size()) - 1 && (value >> (bucket + 1)) != 0) {
+            ++bucket;
+        }
+        ++buckets_[bucket];
+        ++count_;
+        if (value > max_) {
+            max_ = value;
+        }
+    }
+
+    uint32_t count() const
+    {
+        return count_;
+    }
+    uint32_t max() const
+    {
+        return max_;
+    }
+    // p in 0..100
+    uint32_t percentile(uint32_t p) const
+    {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t target = (static_cast<uint64_t>(count_) * p + 99) / 100;
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < buckets_.size(); ++bucket) {
+            seen += buckets_[bucket];
+            if (seen >= target) {
+                uint64_t upper = (2ULL << bucket) - 1;
+                return upper < max_ ? upper : max_;
+            }
+        }
+        return max_;
+    }
+
+private:
+    std::array<uint32_t, 32> buckets_ = {};
+    uint32_t count_ = 0;
+    uint32_t max_ = 0;
+};
+
+// In the units of Measurement
+struct WindowStats
+{
+    SampleStats CO2;
+    SampleStats Temperature;
+    SampleStats Humidity;
+    // Samples the filters dropped
+    uint32_t rejected = 0;
+
+    void reset()
+    {
+        CO2.reset();
+        Temperature.reset();
+        Humidity.reset();
+        rejected = 0;
+    }
+};
+} // namespace weather_station
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace weather_station
+{
+// The sensors wired to this station, in the order WeatherManager polls them. The id names the sensor's MQTT topic,
+// home/weather_station/sensors/<id>. Every DHT has its own PIO state machine, so there can be up to four and they
+// sample concurrently. SCD4x modules share a fixed address, so there is at most one per I2C controller.
+struct SensorConfig
+{
+    enum class Kind : uint8_t { Dht11, Dht22, Scd4x };
+
+    const char* id;
+    Kind kind;
+    // Data line of a DHT
+    uint8_t pin;
+    // I2C controller of an SCD4x
+    uint8_t bus;
+};
+
+struct I2CPins
+{
+    uint8_t sda;
+    uint8_t scl;
+};
+
+// i2c0 on the board's default pins, i2c1 on GP26/GP27
+constexpr I2CPins i2cPins[] = {{4, 5}, {26, 27}};
+
+constexpr SensorConfig topology[] = {
+    {"indoor", SensorConfig::Kind::Dht11, 15, 0},
+    {"indoor-co2", SensorConfig::Kind::Scd4x, 0, 0},
+    // A second room, e.g.
+    // {"bedroom", SensorConfig::Kind::Dht22, 21, 0},
+    // {"bedroom-co2", SensorConfig::Kind::Scd4x, 0, 1},
+};
+
+constexpr size_t maxDhtLanes = 4;
+
+constexpr size_t countSensors(SensorConfig::Kind kind, int bus = -1)
+{
+    size_t count = 0;
+    for (const auto& sensor : topology) {
+        if (sensor.kind == kind && (bus < 0 || sensor.bus == bus)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+static_assert(
+    countSensors(SensorConfig::Kind::Dht11) + countSensors(SensorConfig::Kind::Dht22) <= maxDhtLanes,
+    "a PIO block has four state machines"
+);
+static_assert(
+    countSensors(SensorConfig::Kind::Scd4x, 0) <= 1 && countSensors(SensorConfig::Kind::Scd4x, 1) <= 1,
+    "SCD4x modules all answer on 0x62, one per I2C controller"
+);
+} // namespace weather_station
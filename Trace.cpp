@@ -0,0 +1,93 @@
+#include "Trace.h"
+
+#ifdef TRACE
+#include <pico/stdlib.h>
+#include <hardware/sync.h>
+
+#include <array>
+#include <cstring>
+
+namespace weather_station
+{
+namespace
+{
+constexpr uint32_t ringSize = 512;
+constexpr char magic[8] = {'W', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+constexpr std::array<const char*, static_cast<size_t>(Trace::Point::Count)> names = {
+    "refreshDisplay", "Receiver::process", "fifo push", "fifo pop", "sensor process",
+    "MQTT dns",       "MQTT connection",   "MQTT incoming", "MQTT publish"
+};
+
+struct Ring
+{
+    std::array<Trace::Event, ringSize> events;
+    // Total events recorded, the newest one is at (head - 1) % ringSize
+    volatile uint32_t head = 0;
+};
+
+std::array<Ring, 2> rings;
+volatile bool paused = false;
+
+void write(const void* data, size_t size)
+{
+    // putchar_raw skips the CRLF translation, which would corrupt the binary data
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        putchar_raw(bytes[i]);
+    }
+}
+
+void writeWord(uint32_t word)
+{
+    write(&word, sizeof(word));
+}
+} // namespace
+
+void Trace::record(Point point, Kind kind, uint32_t arg, uint64_t time)
+{
+    if (paused) {
+        return;
+    }
+    auto core = get_core_num();
+    auto& ring = rings[core];
+    auto irq = save_and_disable_interrupts();
+    auto head = ring.head;
+    ring.events[head % ringSize] = Event{time, arg, point, kind, static_cast<uint8_t>(core), 0};
+    __dmb();
+    ring.head = head + 1;
+    restore_interrupts(irq);
+}
+
+void Trace::dump()
+{
+    paused = true;
+    __dmb();
+    // Lets an event that core 1 started recording before it saw the flag land
+    busy_wait_us(10);
+
+    // Little endian: magic, number of point names, the names NUL terminated, number of events, then the events
+    write(magic, sizeof(magic));
+    writeWord(names.size());
+    for (auto name : names) {
+        write(name, strlen(name) + 1);
+    }
+    uint32_t total = 0;
+    for (const auto& ring : rings) {
+        total += ring.head < ringSize ? ring.head : ringSize;
+    }
+    writeWord(total);
+    for (auto& ring : rings) {
+        uint32_t head = ring.head;
+        uint32_t first = head < ringSize ? 0 : head - ringSize;
+        for (uint32_t i = first; i < head; ++i) {
+            write(&ring.events[i % ringSize], sizeof(Event));
+        }
+        ring.head = 0;
+    }
+    stdio_flush();
+
+    __dmb();
+    paused = false;
+}
+} // namespace weather_station
+#endif
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <pico/time.h>
+
+#include <cstdint>
+
+namespace weather_station
+{
+// Begin/end/instant events stamped with time_us_64 (shared by both cores) into one ring per core. A core only writes
+// its own ring, so recording takes no lock, just a few cycles with interrupts off against lwIP callbacks on the same
+// core. dump() writes both rings to USB in binary, tools/trace_to_perfetto.py turns that into a Chrome/Perfetto trace.
+// Without -DTRACE everything compiles to nothing.
+class Trace
+{
+public:
+    enum class Point : uint8_t {
+        RefreshDisplay,
+        Receive,
+        FifoPush,
+        FifoPop,
+        SensorProcess,
+        MqttDns,
+        MqttConnection,
+        MqttIncoming,
+        MqttPublish,
+        Count
+    };
+    enum class Kind : uint8_t { Begin, End, Instant };
+
+    struct Event
+    {
+        uint64_t time;
+        uint32_t arg;
+        Point point;
+        Kind kind;
+        uint8_t core;
+        uint8_t reserved;
+    };
+    static_assert(sizeof(Event) == 16);
+
+    // Records begin on construction and end on destruction
+    class Scope
+    {
+    public:
+        explicit Scope(Point point, uint32_t arg = 0)
+            : point_(point)
+        {
+            begin(point_, arg);
+        }
+        ~Scope()
+        {
+            end(point_);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const Point point_;
+    };
+
+#ifdef TRACE
+    static void record(Point point, Kind kind, uint32_t arg, uint64_t time);
+    // Writes both rings to stdout and starts over, call from core 0
+    static void dump();
+
+    static void begin(Point point, uint32_t arg = 0)
+    {
+        record(point, Kind::Begin, arg, time_us_64());
+    }
+    static void end(Point point)
+    {
+        record(point, Kind::End, 0, time_us_64());
+    }
+    static void instant(Point point, uint32_t arg = 0)
+    {
+        record(point, Kind::Instant, arg, time_us_64());
+    }
+    // Records a span that started at start and ends now, for code that only knows afterwards whether it was worth it
+    static void span(Point point, uint64_t start, uint32_t arg = 0)
+    {
+        record(point, Kind::Begin, arg, start);
+        record(point, Kind::End, 0, time_us_64());
+    }
+#else
+    static void dump()
+    {
+    }
+    static void begin(Point, uint32_t = 0)
+    {
+    }
+    static void end(Point)
+    {
+    }
+    static void instant(Point, uint32_t = 0)
+    {
+    }
+    static void span(Point, uint64_t, uint32_t = 0)
+    {
+    }
+#endif
+};
+} // namespace weather_station
@@ -0,0 +1,138 @@
+#include "UdpExporter.h"
+#include "Network.h"
+#include "PeerReading.h"
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "lwip/dns.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace weather_station
+{
+UdpExporter::UdpExporter(std::string host, uint16_t port, Format format)
+    : host_(std::move(host))
+    , port_(port)
+    , format_(format)
+{
+    Network::init();
+    cyw43_arch_lwip_begin();
+    pcb_ = udp_new_ip_type(IPADDR_TYPE_ANY);
+    cyw43_arch_lwip_end();
+    if (!pcb_) {
+        std::cout << "Failed to create UDP pcb\n";
+    }
+}
+
+UdpExporter::~UdpExporter()
+{
+    if (pcb_) {
+        cyw43_arch_lwip_begin();
+        udp_remove(pcb_);
+        cyw43_arch_lwip_end();
+    }
+}
+
+bool UdpExporter::resolve()
+{
+    if (resolved_ || resolving_) {
+        return resolved_;
+    }
+    auto err = dns_gethostbyname(host_.c_str(), &addr_, UdpExporter::dnsFoundCallback, this);
+    if (err == ERR_OK) {
+        resolved_ = true;
+    } else if (err == ERR_INPROGRESS) {
+        resolving_ = true;
+    } else {
+        std::cout << "UDP exporter: DNS request failed\n";
+    }
+    return resolved_;
+}
+
+void UdpExporter::dnsFound(const ip_addr_t* ipaddr)
+{
+    resolving_ = false;
+    if (!ipaddr) {
+        std::cout << "UDP exporter: DNS request failed\n";
+        return;
+    }
+    addr_ = *ipaddr;
+    resolved_ = true;
+    std::cout << "UDP exporter sending to " << ipaddr_ntoa(&addr_) << ":" << port_ << "\n";
+}
+
+bool UdpExporter::reportWeather(const Measurement& measurement, uint64_t timestamp, uint32_t sequence)
+{
+    auto start = time_us_64();
+    bool sent = false;
+    cyw43_arch_lwip_begin();
+    if (pcb_ && resolve()) {
+        int size = 0;
+        int co2 = measurement.CO2;
+        CentiText temp(measurement.Temperature);
+        CentiText hum(measurement.Humidity);
+        if (format_ == Format::StatsD) {
+            size = snprintf(
+                buffer_.data(), buffer_.size(),
+                "weather.%s.co2:%d|g\nweather.%s.temperature:%s|g\nweather.%s.humidity:%s|g",
+                Network::stationId().c_str(), co2, Network::stationId().c_str(), temp.c_str(),
+                Network::stationId().c_str(), hum.c_str()
+            );
+        } else if (format_ == Format::Compact) {
+            PeerReading reading;
+            const auto& station = Network::stationId();
+            memcpy(reading.station.data(), station.data(), std::min(station.size(), reading.station.size() - 1));
+            reading.sequence = sequence;
+            reading.stamp = timestamp / 1000000;
+            reading.co2 = co2;
+            reading.temperature = measurement.Temperature;
+            reading.humidity = measurement.Humidity;
+            memcpy(buffer_.data(), &reading, sizeof(reading));
+            size = sizeof(reading);
+        } else {
+            size = snprintf(
+                buffer_.data(), buffer_.size(), "weather,station=%s co2=%di,temperature=%s,humidity=%s",
+                Network::stationId().c_str(), co2, temp.c_str(), hum.c_str()
+            );
+            if (timestamp != 0 && size > 0 && static_cast<size_t>(size) < buffer_.size()) {
+                size += snprintf(
+                    buffer_.data() + size, buffer_.size() - size, " %llu",
+                    static_cast<unsigned long long>(timestamp * 1000)
+                );
+            }
+        }
+        if (size > 0 && static_cast<size_t>(size) < buffer_.size()) {
+            sent = send(size);
+        }
+    }
+    cyw43_arch_lwip_end();
+    ++stats_.samples;
+    stats_.cpuUs += time_us_64() - start;
+    return sent;
+}
+
+bool UdpExporter::send(size_t size)
+{
+    // A PBUF_REF over our buffer avoids copying the payload, lwIP chains its own header pbuf in front and copies
+    // the datagram if it has to be queued (e.g. waiting for ARP), so the buffer is free again once this returns
+    auto p = pbuf_alloc(PBUF_TRANSPORT, size, PBUF_REF);
+    if (!p) {
+        std::cout << "UDP exporter: out of pbufs\n";
+        return false;
+    }
+    p->payload = buffer_.data();
+    auto err = udp_sendto(pcb_, p, &addr_, port_);
+    pbuf_free(p);
+    if (err != ERR_OK) {
+        std::cout << "UDP exporter: send failed " << (int)err << "\n";
+        return false;
+    }
+    ++stats_.frames;
+    stats_.airBytes += size + ExportStats::udpFrameOverhead;
+    return true;
+}
+} // namespace weather_station
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ExportStats.h"
+#include "Measurement.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+
+#include <array>
+#include <string>
+
+namespace weather_station
+{
+// Fire-and-forget export of gauges over UDP, several metrics per datagram in StatsD or InfluxDB line format, or as a
+// binary PeerReading for a gateway station. No connection state, no acknowledgements, a lost datagram is simply a
+// lost sample.
+class UdpExporter
+{
+public:
+    enum class Format { StatsD, Influx, Compact };
+
+    UdpExporter(std::string host, uint16_t port, Format format);
+    ~UdpExporter();
+
+    // Formats one sample into the datagram and sends it, true once lwIP has taken it
+    // timestamp is UTC microseconds, the StatsD format leaves it out. sequence (flash log) is only sent by Compact.
+    bool reportWeather(const Measurement& measurement, uint64_t timestamp, uint32_t sequence = 0);
+
+    const ExportStats& stats() const
+    {
+        return stats_;
+    }
+
+private:
+    void dnsFound(const ip_addr_t* ipaddr);
+    static void dnsFoundCallback(const char* hostname, const ip_addr_t* ipaddr, void* arg)
+    {
+        static_cast<UdpExporter*>(arg)->dnsFound(ipaddr);
+    }
+
+    bool resolve();
+    bool send(size_t size);
+
+    const std::string host_;
+    const uint16_t port_;
+    const Format format_;
+
+    udp_pcb* pcb_ = nullptr;
+    ip_addr_t addr_;
+    bool resolved_ = false;
+    bool resolving_ = false;
+
+    // Below any sane path MTU so a datagram is never fragmented
+    std::array<char, 512> buffer_;
+    ExportStats stats_;
+};
+} // namespace weather_station
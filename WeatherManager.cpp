@@ -1,4 +1,7 @@
 #include "WeatherManager.h"
+#include "I2CBus.h"
+#include "Topology.h"
+#include "Trace.h"
 #include "ino_compat.h"
 
 #include <iostream>
@@ -6,36 +9,124 @@
 
 namespace weather_station
 {
-WeatherManager::WeatherManager(int dhtPin)
+WeatherManager::WeatherManager()
 {
-    sensors_.emplace_back(
-        std::make_unique<DHT_nonblocking>(dhtPin, DHT_nonblocking::Type::DHT_TYPE_11)
-    );
-    sensors_.emplace_back(std::make_unique<SCD>());
+    for (const auto& config : topology) {
+        if (config.kind == SensorConfig::Kind::Scd4x) {
+            if (scds_.empty()) {
+                displayedSensor_ = co2Sensor_ = sensors_.size();
+            }
+            auto scd = std::make_unique<SCD>(config.bus);
+            scds_.push_back(scd.get());
+            sensors_.emplace_back(std::move(scd));
+        } else {
+            auto type = config.kind == SensorConfig::Kind::Dht22 ? DHT_nonblocking::Type::DHT_TYPE_22
+                                                                 : DHT_nonblocking::Type::DHT_TYPE_11;
+            auto dht = std::make_unique<DHT_nonblocking>(config.pin, type);
+            dhts_.push_back(dht.get());
+            sensors_.emplace_back(std::move(dht));
+        }
+        readings_.push_back({config.id, {}});
+        filters_.push_back(SensorFilter::create(config.kind));
+    }
 
     measurements_.resize(sensors_.size());
+    times_.resize(sensors_.size());
     lastMeasurement_.resize(sensors_.size());
+    windowStats_.resize(sensors_.size());
     std::fill(lastMeasurement_.begin(), lastMeasurement_.end(), 0);
 }
 
+void WeatherManager::configure(const Settings& settings)
+{
+    policy_.setIntervals(settings.reportMin, settings.reportFast, settings.reportMax);
+    for (auto scd : scds_) {
+        scd->setPollInterval(settings.scdPoll);
+    }
+    scdMode_ = settings.scdMode;
+}
+
+void WeatherManager::clockChanged()
+{
+    for (auto& sensor : sensors_) {
+        sensor->clockChanged();
+    }
+}
+
+bool WeatherManager::busy() const
+{
+    return I2CBus::anyBusy();
+}
+
+void WeatherManager::printStats() const
+{
+    for (auto dht : dhts_) {
+        dht->printStats();
+    }
+    for (auto scd : scds_) {
+        scd->printStats();
+    }
+    for (size_t i = 0; i < filters_.size(); ++i) {
+        filters_[i]->printStats(readings_[i].id);
+    }
+    I2CBus::printAllStats();
+}
+
 uint64_t WeatherManager::process()
 {
+    // Completes the bus transactions the sensors have queued and starts the next ones. Sensors only start work and
+    // pick up results here, so the acquisitions of all of them overlap.
+    I2CBus::processAll();
     for (int i = 0; i < sensors_.size(); ++i) {
         auto& sensor = sensors_[i];
-        if (sensor->process()) {
-            measurements_[i] = sensor->GetMeasurement();
-            std::cout << "Sensor: " << i << " CO2: " << measurements_[i].CO2
-                      << " Temp: " << measurements_[i].Temperature
-                      << " Humidity: " << measurements_[i].Humidity << "\n";
-            if (measurements_[i].CO2 == 0) {
-                measurements_[i].CO2 = (*std::max_element(
-                                            measurements_.begin(), measurements_.end(),
-                                            [](auto& a, auto& b) { return a.CO2 < b.CO2; }
-                                        )).CO2;
+        auto start = time_us_64();
+        bool ready = sensor->process();
+        // Most calls return right away, only the ones that talked to the sensor are worth a span
+        if (time_us_64() - start > 50) {
+            Trace::span(Trace::Point::SensorProcess, start, i);
+        }
+        if (ready) {
+            auto sample = sensor->GetMeasurement();
+            auto& stats = windowStats_[i];
+            if (!filters_[i]->apply(sample)) {
+                std::cout << "Sensor: " << i << " sample rejected\n";
+                ++stats.rejected;
+                continue;
+            }
+            measurements_[i] = sample;
+            times_[i] = sensor->GetTime();
+            readings_[i].measurement = sample;
+            readings_[i].time = times_[i];
+            std::cout << "Sensor: " << i << " CO2: " << sample.CO2 << " Temp: ";
+            writeCenti(std::cout, sample.Temperature);
+            std::cout << " Humidity: ";
+            writeCenti(std::cout, sample.Humidity);
+            std::cout << "\n";
+            if (sample.has(Measurement::HasCO2)) {
+                stats.CO2.add(sample.CO2);
+            }
+            if (sample.has(Measurement::HasTemperature)) {
+                stats.Temperature.add(sample.Temperature);
+            }
+            if (sample.has(Measurement::HasHumidity)) {
+                stats.Humidity.add(sample.Humidity);
             }
             lastMeasurement_[i] = millis();
+            if (i == displayedSensor_) {
+                policy_.sample(measurement(), lastMeasurement_[i]);
+            }
         }
     }
+    // Let the SCDs sample less often while the air is not changing, unless a mode was forced
+    auto mode = SCD::Mode::Periodic;
+    if (scdMode_ == Settings::ScdMode::Auto) {
+        mode = policy_.stable(millis()) ? SCD::Mode::LowPower : SCD::Mode::Periodic;
+    } else if (scdMode_ == Settings::ScdMode::LowPower) {
+        mode = SCD::Mode::LowPower;
+    }
+    for (auto scd : scds_) {
+        scd->setMode(mode);
+    }
     return *std::min_element(lastMeasurement_.begin(), lastMeasurement_.end());
 }
 
@@ -44,28 +135,62 @@ void WeatherManager::display(MultiDisplay& md)
 {
     const Sensor::Measurement& measurement = measurements_[displayedSensor_];
     md.setNumber(0, measurement.CO2);
-    md.setNumberF(1, measurement.Temperature, 2);
+    md.setNumber(1, measurement.Temperature, 2);
     md.setSegment(1, 3, 0b01011000);
-    md.setNumberF(2, measurement.Humidity, 2);
+    md.setNumber(2, measurement.Humidity, 2);
 }
 */
 
-int WeatherManager::CO2()
+void WeatherManager::updateHistory(uint64_t now)
+{
+    if (lastMeasurement_[displayedSensor_] != 0) {
+        history_->add(now, measurement());
+    }
+}
+
+bool WeatherManager::reportDue(uint64_t now) const
+{
+    return policy_.due(now);
+}
+
+void WeatherManager::reported(uint64_t now)
+{
+    policy_.reported(now);
+    for (auto& stats : windowStats_) {
+        stats.reset();
+    }
+}
+
+const WindowStats& WeatherManager::windowStats() const
 {
-    const auto& measurement = measurements_[displayedSensor_];
-    return measurement.CO2;
+    return windowStats_[displayedSensor_];
 }
 
-float WeatherManager::temperature()
+Sensor::Measurement WeatherManager::measurement() const
 {
-    const auto& measurement = measurements_[displayedSensor_];
-    return measurement.Temperature;
+    auto measurement = measurements_[displayedSensor_];
+    if (!measurement.has(Measurement::HasCO2) && co2Sensor_ >= 0) {
+        const auto& co2 = measurements_[co2Sensor_];
+        measurement.CO2 = co2.CO2;
+        measurement.Valid |= co2.Valid & Measurement::HasCO2;
+    }
+    return measurement;
 }
 
-float WeatherManager::humidity()
+uint64_t WeatherManager::measurementTime() const
 {
-    const auto& measurement = measurements_[displayedSensor_];
-    return measurement.Humidity;
+    return times_[displayedSensor_];
+}
+
+std::vector<SensorReading> WeatherManager::readings() const
+{
+    std::vector<SensorReading> readings;
+    for (const auto& reading : readings_) {
+        if (reading.time != 0) {
+            readings.push_back(reading);
+        }
+    }
+    return readings;
 }
 
 void WeatherManager::switchDisplay()
@@ -2,6 +2,11 @@
 
 #include "dht_nonblocking.h"
 #include "SCD.h"
+#include "SensorFilter.h"
+#include "ReportingPolicy.h"
+#include "Statistics.h"
+#include "History.h"
+#include "Settings.h"
 
 #include "MultiDisplay.h"
 
@@ -14,19 +19,54 @@ namespace weather_station
 class WeatherManager
 {
 public:
-    explicit WeatherManager(int dhtPin);
+    // Sets up the sensors listed in Topology.h
+    WeatherManager();
     uint64_t process();
+    // Applies the report intervals and SCD settings
+    void configure(const Settings& settings);
+    // Call after clk_sys has been changed
+    void clockChanged();
+    // Sensor transfers are in flight, clk_sys has to stay as it is
+    bool busy() const;
+    void printStats() const;
+
+    // Separate from process() so callers can hold whatever lock protects readers of the history
+    void updateHistory(uint64_t now);
+    bool reportDue(uint64_t now) const;
+    void reported(uint64_t now);
+    // Statistics of the reported sensor since the last report
+    const WindowStats& windowStats() const;
+    const History& history() const
+    {
+        return *history_;
+    }
 
     void switchDisplay();
-    int CO2();
-    float temperature();
-    float humidity();
+    // The displayed sensor's sample, with the CO2 of the first SCD for sensors that have none
+    Sensor::Measurement measurement() const;
+    // time_us_64() of the displayed sensor's sample, 0 before the first one
+    uint64_t measurementTime() const;
+    // Own latest sample of every sensor that has delivered one, without the CO2 filled in for the display
+    std::vector<SensorReading> readings() const;
 
 private:
     std::vector<std::unique_ptr<Sensor>> sensors_;
     std::vector<Sensor::Measurement> measurements_;
+    std::vector<uint64_t> times_;
     std::vector<uint64_t> lastMeasurement_;
+    std::vector<WindowStats> windowStats_;
+    std::vector<SensorReading> readings_;
+    std::vector<std::unique_ptr<SensorFilter>> filters_;
+
+    std::vector<DHT_nonblocking*> dhts_;
+    std::vector<SCD*> scds_;
+    ReportingPolicy policy_;
+    Settings::ScdMode scdMode_ = Settings::ScdMode::Auto;
+    // Too big for the stack of the processing thread
+    std::unique_ptr<History> history_ = std::make_unique<History>();
 
-    int displayedSensor_ = 1;
+    // The first SCD if there is one
+    int displayedSensor_ = 0;
+    int co2Sensor_ = -1;
 };
 } // namespace weather_station
@@ -21,6 +21,8 @@
 #include <iostream>
 
 #include "dht_nonblocking.h"
+#include "DhtDecoder.h"
+#include "FaultInjector.h"
 #include "pico/stdlib.h"
 #include "ino_compat.h"
 
@@ -43,24 +45,21 @@ namespace weather_station
 DHT_nonblocking::DHT_nonblocking(uint8_t pin, Type type)
     : _pin(pin)
     , _type(type)
-    , _maxcycles(12500)
+    , lane_(pin)
 {
     dht_state = DHT_IDLE;
-
-    gpio_init(pin);
-    gpio_set_dir(pin, false);
-    gpio_put(pin, 1);
 }
 
 /*
  * Instruct the DHT to begin sampling.  Keep polling until it returns true.
- * The tempearture is in degrees Celsius, and the humidity is in %.
+ * The tempearture is in 0.01 degrees Celsius, and the humidity is in 0.01 %.
  */
-bool DHT_nonblocking::measure(float* temperature, float* humidity)
+bool DHT_nonblocking::measure(Measurement& measurement)
 {
     if (read_nonblocking() == true) {
-        *temperature = read_temperature();
-        *humidity = read_humidity();
+        measurement.Temperature = read_temperature();
+        measurement.Humidity = read_humidity();
+        measurement.Valid = Measurement::HasTemperature | Measurement::HasHumidity;
         return true;
     } else {
         return false;
@@ -73,22 +72,28 @@ bool DHT_nonblocking::process()
     if (now - lastMEasurement_ < 5000) {
         return false;
     }
-    auto res = measure(&measurement_.Temperature, &measurement_.Humidity);
+    auto res = measure(measurement_);
     if (res) {
+        time_ = micros();
         lastMEasurement_ = now;
     }
     return res;
 }
 
-float DHT_nonblocking::read_temperature() const
+void DHT_nonblocking::clockChanged()
+{
+    lane_.clockChanged();
+}
+
+int16_t DHT_nonblocking::read_temperature() const
 {
     int16_t value;
-    float to_return;
+    int16_t to_return;
 
     switch (_type) {
         case Type::DHT_TYPE_11:
             value = data[2];
-            to_return = (float)value;
+            to_return = value * 100;
             break;
 
         case Type::DHT_TYPE_21:
@@ -98,7 +103,7 @@ float DHT_nonblocking::read_temperature() const
             if ((data[2] & 0x80) != 0) {
                 value = -value;
             }
-            to_return = ((float)value) / 10.0;
+            to_return = value * 10;
             break;
 
         default:
@@ -109,22 +114,22 @@ float DHT_nonblocking::read_temperature() const
     return (to_return);
 }
 
-float DHT_nonblocking::read_humidity() const
+uint16_t DHT_nonblocking::read_humidity() const
 {
     uint16_t value;
-    float to_return;
+    uint16_t to_return;
 
     switch (_type) {
         case Type::DHT_TYPE_11:
             value = data[0];
-            to_return = (float)value;
+            to_return = value * 100;
             break;
 
         case Type::DHT_TYPE_21:
         case Type::DHT_TYPE_22:
             value = data[0] << 8;
             value |= data[1];
-            to_return = (float)value / 10.0;
+            to_return = value * 10;
             break;
 
         default:
@@ -135,36 +140,6 @@ float DHT_nonblocking::read_humidity() const
     return (to_return);
 }
 
-/*
- * Expect the input to be at the specified level and return the number
- * of loop cycles spent there.  This is identical to Adafruit's blocking
- * driver.
- */
-uint32_t DHT_nonblocking::expect_pulse(bool level) const
-{
-    uint32_t count = 0;
-// On AVR platforms use direct GPIO port access as it's much faster and better
-// for catching pulses that are 10's of microseconds in length:
-#ifdef __AVR
-    uint8_t portState = level ? _bit : 0;
-    while ((*portInputRegister(_port) & _bit) == portState) {
-        if (count++ >= _maxcycles) {
-            return 0; // Exceeded timeout, fail.
-        }
-    }
-// Otherwise fall back to using digitalRead (this seems to be necessary on ESP8266
-// right now, perhaps bugs in direct port access functions?).
-#else
-    while (gpio_get(_pin) == level) {
-        if (count++ >= _maxcycles) {
-            return 0; // Exceeded timeout, fail.
-        }
-    }
-#endif
-
-    return count;
-}
-
 /*
  * State machine of the non-blocking read.
  */
@@ -178,39 +153,34 @@ bool DHT_nonblocking::read_nonblocking()
             dht_state = DHT_BEGIN_MEASUREMENT;
             break;
 
-        /* Initiate a sensor read.  The read begins by going to high impedance
-     state for 250 ms. */
+        /* Initiate a sensor read.  The read begins by leaving the line
+     released (high impedance) for 250 ms. */
         case DHT_BEGIN_MEASUREMENT:
-            gpio_put(_pin, 1);
             /* Reset 40 bits of received data to zero. */
             data[0] = data[1] = data[2] = data[3] = data[4] = 0;
             dht_timestamp = millis();
             dht_state = DHT_BEGIN_MEASUREMENT_2;
             break;
 
-        /* After the high impedance state, pull the pin low for 20 ms. */
+        /* After the high impedance state, the lane pulls the pin low, for
+     20 ms on a DHT11 and 1.1 ms on the others, and times the answer. */
         case DHT_BEGIN_MEASUREMENT_2:
             /* Wait for 250 ms. */
             if (millis() - dht_timestamp > 250) {
-                pinMode(_pin, OUTPUT);
-                digitalWrite(_pin, LOW);
-                dht_timestamp = millis();
+                lane_.start(_type == Type::DHT_TYPE_11 ? 20000 : 1100);
                 dht_state = DHT_DO_READING;
             }
             break;
 
-        case DHT_DO_READING:
-            /* Wait for 20 ms. */
-            if (millis() - dht_timestamp > 20) {
+        case DHT_DO_READING: {
+            DhtDecoder::Trace trace;
+            if (lane_.poll(trace)) {
                 dht_timestamp = millis();
                 dht_state = DHT_COOLDOWN;
-                status = read_data();
-                //      if( status != true )
-                //      {
-                //        Serial.println( "Reading failed" );
-                //      }
+                status = read_data(trace);
             }
             break;
+        }
 
         /* If it has been less than two seconds since the last time we read
      the sensor, then let the sensor cool down.. */
@@ -227,84 +197,44 @@ bool DHT_nonblocking::read_nonblocking()
     return (status);
 }
 
-/* Read sensor data.  This is identical to Adafruit's blocking driver. */
-bool DHT_nonblocking::read_data()
+/* Decode the edges the lane has timed.  DhtDecoder works on the edge
+   times, so a failed frame can be dumped and replayed exactly as it was seen. */
+bool DHT_nonblocking::read_data(DhtDecoder::Trace& trace)
 {
-    uint32_t cycles[80];
-
-    /* Turn off interrupts temporarily because the next sections are timing critical
-     and we don't want any interruptions. */
-    {
-        //volatile DHT_interrupt interrupt;
-
-        // End the start signal by setting data line high for 40 microseconds.
-        digitalWrite(_pin, HIGH);
-        sleep_us(40);
-
-        // Now start reading the data line to get the value from the DHT sensor.
-        pinMode(_pin, false);
-        // Delay a bit to let sensor pull data line low.
-        sleep_us(10);
-
-        // First expect a low signal for ~80 microseconds followed by a high signal
-        // for ~80 microseconds again.
-        if (expect_pulse(LOW) == 0) {
-            std::cout << "Low fail1\n";
-            return false;
-        }
-        if (expect_pulse(HIGH) == 0) {
-            std::cout << "High fail1\n";
-            return false;
-        }
-
-        // Now read the 40 bits sent by the sensor.  Each bit is sent as a 50
-        // microsecond low pulse followed by a variable length high pulse.  If the
-        // high pulse is ~28 microseconds then it's a 0 and if it's ~70 microseconds
-        // then it's a 1.  We measure the cycle count of the initial 50us low pulse
-        // and use that to compare to the cycle count of the high pulse to determine
-        // if the bit is a 0 (high state cycle count < low state cycle count), or a
-        // 1 (high state cycle count > low state cycle count). Note that for speed all
-        // the pulses are read into a array and then examined in a later step.
-        for (int i = 0; i < 80; i += 2) {
-            cycles[i] = expect_pulse(LOW);
-            cycles[i + 1] = expect_pulse(HIGH);
+    if (FaultInjector::fail(FaultInjector::Fault::DhtGlitch) && trace.count > 10) {
+        // A spike on the line merges two pulses, one edge goes missing
+        auto missing = trace.count / 2;
+        for (size_t i = missing; i + 1 < trace.count; ++i) {
+            trace.edges[i] = trace.edges[i + 1];
         }
-
-        /* Timing critical code is now complete. */
+        --trace.count;
     }
 
-    //std::cout << "Bla! ";
-    //for (int i=0; i<80; ++i) {
-    //  std::cout << cycles[i] << " ";
-    //}
-    //std::cout << "\n";
-
-    // Inspect pulses and determine which ones are 0 (high state cycle count < low
-    // state cycle count), or 1 (high state cycle count > low state cycle count).
-    for (int i = 0; i < 40; ++i) {
-        uint32_t low_cycles = cycles[2 * i];
-        uint32_t high_cycles = cycles[2 * i + 1];
-        if ((low_cycles == 0) || (high_cycles == 0)) {
-            std::cout << "cycle fail\n";
-            return false;
-        }
-        data[i / 8] <<= 1;
-        // Now compare the low and high cycle times to see if the bit is a 0 or 1.
-        if (high_cycles > low_cycles) {
-            // High cycles are greater than 50us low cycle count, must be a 1.
-            data[i / 8] |= 1;
-        }
-        // Else high cycles are less than (or equal to, a weird case) the 50us low
-        // cycle count so this must be a zero.  Nothing needs to be changed in the
-        // stored data.
+    auto result = DhtDecoder::decode(trace, data);
+    ++results_[static_cast<size_t>(result)];
+    if (result != DhtDecoder::Result::Ok) {
+        std::cout << "DHT " << int(_pin) << " read failed: " << DhtDecoder::name(result) << "\n";
+        lastFailure_ = trace;
+        return false;
     }
+    return true;
+}
 
-    // Check we read 40 bits and that the checksum matches.
-    if (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
-        return true;
-    } else {
-        std::cout << "crc fail\n";
-        return false;
+void DHT_nonblocking::printStats() const
+{
+    std::cout << "DHT " << int(_pin) << " reads:";
+    for (size_t i = 0; i < results_.size(); ++i) {
+        std::cout << " " << DhtDecoder::name(static_cast<DhtDecoder::Result>(i)) << " " << results_[i];
+    }
+    std::cout << "\n";
+    if (lastFailure_.count == 0) {
+        return;
+    }
+    // Relative edge times of the last failed frame, in the format the decoder replay takes
+    std::cout << "DHT " << int(_pin) << " last failed trace:";
+    for (size_t i = 0; i < lastFailure_.count; ++i) {
+        std::cout << " " << lastFailure_.edges[i] - lastFailure_.edges[0];
     }
+    std::cout << "\n";
 }
 } // namespace weather_station
@@ -20,7 +20,10 @@
 #pragma once
 
 #include "Sensor.h"
+#include "DhtDecoder.h"
+#include "DhtLane.h"
 
+#include <array>
 #include <stdint.h>
 #include <hardware/sync.h>
 namespace weather_station
@@ -31,23 +34,27 @@ public:
     enum class Type { DHT_TYPE_11 = 0, DHT_TYPE_21 = 1, DHT_TYPE_22 = 2 };
     DHT_nonblocking(uint8_t pin, Type type);
     bool process() override;
+    void clockChanged() override;
+    // Read outcomes by failure reason and the edges of the last failed frame
+    void printStats() const;
 
 private:
-    bool measure(float* temperature, float* humidity);
+    bool measure(Measurement& measurement);
 
-    bool read_data();
+    bool read_data(DhtDecoder::Trace& trace);
     bool read_nonblocking();
-    float read_temperature() const;
-    float read_humidity() const;
-    uint32_t expect_pulse(bool level) const;
+    int16_t read_temperature() const;
+    uint16_t read_humidity() const;
 
     uint8_t dht_state;
     unsigned long dht_timestamp;
-    uint8_t data[6];
+    std::array<uint8_t, 5> data;
     const uint8_t _pin;
     Type _type;
-    const uint64_t _maxcycles;
+    DhtLane lane_;
     uint64_t lastMEasurement_ = 0;
+    std::array<uint32_t, static_cast<size_t>(DhtDecoder::Result::Count)> results_ = {};
+    DhtDecoder::Trace lastFailure_;
 };
 
 class DHT_interrupt
@@ -7,6 +7,7 @@
 #define OUTPUT GPIO_OUT
 
 extern "C" {
+// The timer counts clk_ref ticks from the crystal, so these stay correct when clk_sys is scaled
 inline uint64_t micros()
 {
     return time_us_64();
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+
 
 // Common settings used in most of the pico_w examples
 // (see https://www.nongnu.org/lwip/2_1_x/group__lwip__opts.html for details)
@@ -21,6 +23,8 @@
 #define MEM_ALIGNMENT               4
 #define MEM_SIZE                    4000
 #define MEMP_NUM_TCP_SEG            32
+// MQTT, push client, HTTP listener and its 4 connections plus some in TIME_WAIT
+#define MEMP_NUM_TCP_PCB            12
 #define MEMP_NUM_ARP_QUEUE          10
 #define PBUF_POOL_SIZE              24
 #define LWIP_ARP                    1
@@ -50,6 +54,33 @@
 #define LWIP_NETIF_TX_SINGLE_PBUF   1
 #define DHCP_DOES_ARP_CHECK         0
 #define LWIP_DHCP_DOES_ACD_CHECK    0
+// room for the JSON statistics payload, the default of 256 bytes is too small
+#define MQTT_OUTPUT_RINGBUF_SIZE    1024
+// MQTT, MQTT reconnect and SNTP timers on top of the stack's own, the soak test holds publishes back with one more
+#ifdef MQTT_SOAK
+#define MEMP_NUM_SYS_TIMEOUT        (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 4)
+#else
+#define MEMP_NUM_SYS_TIMEOUT        (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 3)
+#endif
+#define SNTP_SERVER_DNS             1
+#define SNTP_STARTUP_DELAY          0
+#define SNTP_UPDATE_DELAY           (15 * 60 * 1000)
+#define SNTP_SET_SYSTEM_TIME_US(sec, us) clock_sntp_set(sec, us)
+#ifdef __cplusplus
+extern "C"
+#endif
+void clock_sntp_set(uint32_t sec, uint32_t us);
+
+#ifdef MQTT_TLS
+#define LWIP_ALTCP                  1
+#define LWIP_ALTCP_TLS              1
+#define LWIP_ALTCP_TLS_MBEDTLS      1
+#ifdef MQTT_TLS_CA
+#define ALTCP_MBEDTLS_AUTHMODE      MBEDTLS_SSL_VERIFY_REQUIRED
+#else
+#define ALTCP_MBEDTLS_AUTHMODE      MBEDTLS_SSL_VERIFY_NONE
+#endif
+#endif
 
 #ifndef NDEBUG
 #define LWIP_DEBUG                  1
@@ -85,4 +116,3 @@
 #define PPP_DEBUG                   LWIP_DBG_OFF
 #define SLIP_DEBUG                  LWIP_DBG_OFF
 #define DHCP_DEBUG                  LWIP_DBG_OFF
-#define MEMP_NUM_SYS_TIMEOUT            (LWIP_NUM_SYS_TIMEOUT_INTERNAL+1)
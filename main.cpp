@@ -3,21 +3,39 @@
 #include "MultiDisplay.h"
 #include "Button.h"
 #include "Comm.h"
-//#include "TCP.h"
+#include "PushClient.h"
+#include "UdpExporter.h"
+#include "HttpServer.h"
 #include "MQTT.h"
+#include "FlashLog.h"
+#include "Settings.h"
+#include "Clock.h"
+#include "RadioPower.h"
+#include "PowerManager.h"
+#include "Gateway.h"
+#include "Network.h"
+#include "Trace.h"
+#include "Benchmark.h"
+#include "FaultInjector.h"
 #include "ino_compat.h"
 
 #include <pico/stdlib.h>
 #include <pico/binary_info.h>
 #include <pico/multicore.h>
+#include <pico/flash.h>
+#include <pico/cyw43_arch.h>
 #include <hardware/adc.h>
+#include <hardware/sync.h>
 
 #include <iostream>
+#include <sstream>
 #include <vector>
 #include <array>
 
 void displayThread()
 {
+    // Lets core 0 park us while it writes the flash log
+    flash_safe_execute_core_init();
     weather_station::MultiDisplay md(
         11, 12, {16, 13, 19, 10}, {8 + 2, 8 + 5, 8 + 6, 2}, {8 + 3, 8 + 7, 4, 6, 7, 8 + 4, 3, 5}
     );
@@ -27,129 +45,363 @@ void displayThread()
     md.setNumber(3, 4000);
     weather_station::Receiver receiver;
     auto last = millis();
+    bool displayOn = true;
     for (;;) {
-        md.refreshDisplay();
+        if (weather_station::FaultInjector::fail(weather_station::FaultInjector::Fault::SlowFifo)) {
+            // Core 0 blocks in send() once the 8 word queue is full
+            busy_wait_ms(20);
+        }
+        if (displayOn) {
+            md.refreshDisplay();
+        } else if (!weather_station::pending()) {
+            // Adding to the queue sends an event, so the next message wakes us up
+            __wfe();
+        }
         auto now = millis();
         auto msg = receiver.process();
         if (!msg) {
             continue;
         }
         if (msg->type == weather_station::Message::Type::WeatherInfo) {
+            // CO2 in ppm, the rest in centi-units
             md.setNumber(0, msg->data[0]);
-            md.setNumberF(1, reinterpret_cast<float&>(msg->data[1]), 2);
+            md.setNumber(1, static_cast<int32_t>(msg->data[1]), 2);
             md.setSegment(1, 3, 0b01011000);
-            md.setNumberF(2, reinterpret_cast<float&>(msg->data[2]), 2);
-            md.setNumberF(3, reinterpret_cast<float&>(msg->data[3]), 2);
+            md.setNumber(2, static_cast<int32_t>(msg->data[2]), 2);
+            md.setNumber(3, static_cast<int32_t>(msg->data[3]), 2);
             md.setSegment(3, 3, 0b01011000);
         } else if (msg->type == weather_station::Message::Type::IncDelay) {
             md.incDelay();
         } else if (msg->type == weather_station::Message::Type::DecDelay) {
             md.decDelay();
+        } else if (msg->type == weather_station::Message::Type::SetBrightness) {
+            md.setBrightness(msg->data[0]);
+        } else if (msg->type == weather_station::Message::Type::DisplayPower) {
+            displayOn = msg->data[0] != 0;
+            if (!displayOn) {
+                md.blank();
+            }
         }
     }
 }
 
-float read_onboard_temperature()
+// In centi-degrees, the sensor reads 0.706 V at 27 C and drops 1.721 mV per degree
+int32_t read_onboard_temperature()
 {
-    /* 12-bit conversion, assume max value == ADC_VREF == 3.3 V */
-    const float conversionFactor = 3.3f / (1 << 12);
+    /* 12-bit conversion, assume max value == ADC_VREF == 3.3 V, 3300000 / 4096 uV per count */
+    int32_t microvolts = adc_read() * 103125 / 128;
+    return 2700 - (microvolts - 706000) * 100 / 1721;
+}
 
-    float adc = (float)adc_read() * conversionFactor;
-    float tempC = 27.0f - (adc - 0.706f) / 0.001721f;
+// Publishes up to 16 logged records that never reached the broker. Values are in centi-units.
+void replayBacklog(weather_station::MQTT& mqtt, weather_station::FlashLog& log)
+{
+    std::stringstream ss;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    log.forEachUnsent(
+        [&](const weather_station::FlashLog::Record& record) {
+            if (first == 0) {
+                first = record.sequence;
+            }
+            last = record.sequence;
+            ss << record.sequence << "," << record.stamp << "," << record.co2 << "," << record.temperature << ","
+               << record.humidity << "\n";
+        },
+        16
+    );
+    if (first == 0) {
+        // Whatever was left unsent has been overwritten by newer data
+        log.markSent(log.lastMeasurement());
+        return;
+    }
+    mqtt.ReportBacklog(ss.str(), first, last);
+}
 
-    return tempC;
+// Applies the commands received over MQTT and acknowledges each of them
+void processCommands(
+    weather_station::MQTT& mqtt, weather_station::Settings& settings, weather_station::WeatherManager& weather,
+    weather_station::RadioPower& radio, weather_station::PowerManager& power
+)
+{
+    std::string command;
+    while (mqtt.TakeCommand(command)) {
+        std::string response;
+        if (settings.apply(command, response)) {
+            std::cout << "Settings changed: " << settings.describe() << "\n";
+            weather.configure(settings);
+            mqtt.SetQos(settings.qos);
+            radio.configure(settings, millis());
+            power.configure(settings, millis());
+            weather_station::send(static_cast<uint32_t>(weather_station::Message::Type::SetBrightness));
+            weather_station::send(settings.brightness);
+        }
+        mqtt.Acknowledge(response);
+    }
 }
 
+#ifdef MQTT_SOAK
+// Load test against the configured broker: a synthetic report every MQTT_SOAK ms and a dropped connection every
+// soakDropEvery reports, with the publish health printed every minute. MQTT adds the latency and loss configured with
+// MQTT_SOAK_DELAY_MS and MQTT_SOAK_LOSS_PERCENT to every publish.
+void soak(weather_station::MQTT& mqtt, const weather_station::WeatherManager& weather, uint64_t now)
+{
+    constexpr uint32_t soakDropEvery = 100;
+    static uint64_t lastPublish = 0;
+    static uint64_t lastHealth = 0;
+    static uint32_t count = 0;
+
+    if (now - lastPublish >= MQTT_SOAK && mqtt.Ready()) {
+        ++count;
+        if (count % soakDropEvery == 0) {
+            std::cout << "Soak: dropping the connection\n";
+            mqtt.DropConnection();
+        } else {
+            weather_station::Measurement measurement;
+            measurement.CO2 = 400 + count % 400;
+            measurement.Temperature = 2000 + count % 100 * 10;
+            measurement.Humidity = 4000 + count % 200 * 10;
+            measurement.Valid = weather_station::Measurement::HasTemperature | weather_station::Measurement::HasHumidity |
+                                weather_station::Measurement::HasCO2;
+            mqtt.ReportWeather(measurement, weather.windowStats(), weather_station::Clock::toUtc(micros()));
+        }
+        lastPublish = now;
+    }
+    if (now - lastHealth > 60000) {
+        mqtt.PrintHealth();
+        lastHealth = now;
+    }
+}
+#endif
+
 void processingThread()
 {
     adc_init();
     adc_set_temp_sensor_enabled(true);
     adc_select_input(4);
 
-    constexpr int dhtPin = 15;
-    weather_station::WeatherManager weather(dhtPin);
+    weather_station::WeatherManager weather;
 
     uint64_t lastSync = 0;
     printf("Waiting for first measurement... (5 sec)\n");
     sleep_ms(500);
     uint64_t lastFps = millis();
     uint64_t lastTemp = 0;
-    //weather_station::TCPTest tcp;
+    uint64_t lastExportStats = 0;
     weather_station::MQTT mqtt;
+    weather_station::Settings settings;
+#ifdef PUSH_SERVER
+    weather_station::PushClient push(PUSH_SERVER, PUSH_PORT, weather_station::PushClient::Protocol::PUSH_PROTOCOL);
+#endif
+#ifdef UDP_SERVER
+    weather_station::UdpExporter udp(UDP_SERVER, UDP_PORT, weather_station::UdpExporter::Format::UDP_FORMAT);
+#endif
+    static weather_station::FlashLog flashLog;
+    mqtt.SetDeliveryCallback([](uint32_t first, uint32_t last) {
+        weather_station::FaultInjector::delivered(last - first + 1);
+        // Only move the watermark over a contiguous range, gaps are left to the backlog replay
+        if (first <= flashLog.sent() + 1) {
+            flashLog.markSent(last);
+        }
+    });
 
+    static weather_station::RadioPower radio(mqtt, flashLog);
+    static weather_station::PowerManager power;
+    power.setClockCallback([&weather]() { weather.clockChanged(); });
+    power.setBusyCallback([&weather]() { return weather.busy(); });
+
+#ifdef PEER_ONLY
+    // Readings go to the gateway over UDP, no broker connection of our own
+    weather_station::Network::connect();
+#else
     mqtt.Connect();
+#endif
+    weather_station::Clock::start();
+#ifdef GATEWAY_PORT
+    static weather_station::Gateway gateway(GATEWAY_PORT);
+    gateway.start();
+#endif
+
+    static weather_station::HttpServer http(weather.history());
+    http.start();
 
     //for (;;);
 
+    using Gesture = weather_station::Button::Gesture;
     std::array<weather_station::Button, 3> buttons = {
         weather_station::Button{
             17,
-            [&weather] {
-                static int i = 0;
+            [](Gesture gesture) {
+                // The first press on a dark display only turns it back on
+                if (power.activity(millis())) {
+                    return;
+                }
                 //weather.switchDisplay();
-                std::cout << "Button 1\n";
-            }
+                std::cout << "Button 1: " << static_cast<int>(gesture) << "\n";
+            },
+            true
         },
         weather_station::Button{
             18,
-            [] {
-                std::cout << "Button 2\n";
-                multicore_fifo_push_blocking(static_cast<uint32_t>(weather_station::Message::Type::IncDelay));
+            [](Gesture gesture) {
+                if (power.activity(millis())) {
+                    return;
+                }
+                // Holding the button keeps stepping
+                if (gesture == Gesture::Press || gesture == Gesture::Repeat) {
+                    std::cout << "Button 2\n";
+                    weather_station::send(static_cast<uint32_t>(weather_station::Message::Type::IncDelay));
+                }
             }
         },
-        weather_station::Button{20, [] {
-                                    std::cout << "Button 3\n";
-                                    multicore_fifo_push_blocking(
-                                        static_cast<uint32_t>(weather_station::Message::Type::DecDelay)
-                                    );
-                                }}
+        weather_station::Button{
+            20,
+            [](Gesture gesture) {
+                if (power.activity(millis())) {
+                    return;
+                }
+                if (gesture == Gesture::Press || gesture == Gesture::Repeat) {
+                    std::cout << "Button 3\n";
+                    weather_station::send(static_cast<uint32_t>(weather_station::Message::Type::DecDelay));
+                }
+            }
+        }
     };
     uint64_t lastReady = 0;
-    float onboardTemp = 0;
-    uint64_t lastWeatherReport = 0;
+    int32_t onboardTemp = 0;
+    bool displayOn = true;
     for (;;) {
         auto now = millis();
-        for (auto& btn : buttons) {
-            btn.Process();
+        auto loopStart = time_us_64();
+        weather_station::Button::Process();
+#ifdef TRACE
+        // 't' on the USB console dumps the trace rings, see tools/trace_to_perfetto.py
+        if (getchar_timeout_us(0) == 't') {
+            weather_station::Trace::dump();
         }
+#endif
+        processCommands(mqtt, settings, weather, radio, power);
         lastReady = weather.process();
+        // HTTP requests are served from lwIP callbacks, update what they read under the same lock
+        cyw43_arch_lwip_begin();
+        weather.updateHistory(now);
+        http.update(weather.measurement(), weather.measurementTime(), now);
+        cyw43_arch_lwip_end();
 
-        if (now - lastSync > 2000) {
-            auto co2 = weather.CO2();
-            union {
-                float f;
-                uint32_t ui;
-            } temp, hum, onboardT;
-            temp.f = weather.temperature();
-            hum.f = weather.humidity();
-            onboardT.f = onboardTemp;
-            multicore_fifo_push_blocking(static_cast<uint32_t>(weather_station::Message::Type::WeatherInfo));
-            multicore_fifo_push_blocking(co2);
-            multicore_fifo_push_blocking(temp.ui);
-            multicore_fifo_push_blocking(hum.ui);
-            multicore_fifo_push_blocking(onboardT.ui);
+        if (power.displayOn(now) != displayOn) {
+            displayOn = !displayOn;
+            weather_station::send(static_cast<uint32_t>(weather_station::Message::Type::DisplayPower));
+            weather_station::send(displayOn);
+            // Show current values right away when it comes back
+            lastSync = 0;
+        }
+        if (displayOn && now - lastSync > settings.displaySync) {
+            auto measurement = weather.measurement();
+            weather_station::send(static_cast<uint32_t>(weather_station::Message::Type::WeatherInfo));
+            weather_station::send(measurement.CO2);
+            weather_station::send(static_cast<uint32_t>(measurement.Temperature));
+            weather_station::send(measurement.Humidity);
+            weather_station::send(static_cast<uint32_t>(onboardTemp));
             lastSync = millis();
         }
+        if (now - lastExportStats > 60000 * 10) {
+#ifdef UDP_SERVER
+            weather_station::ExportStats::compare("MQTT", mqtt.Stats(), "UDP", udp.stats());
+#else
+            mqtt.Stats().print("MQTT");
+#endif
+            mqtt.PrintConnectStats();
+            mqtt.PrintHealth();
+            radio.printStats(now);
+            power.printStats();
+            weather.printStats();
+            weather_station::FaultInjector::printReport();
+#ifdef GATEWAY_PORT
+            gateway.printStats(now);
+#endif
+            lastExportStats = now;
+        }
         if (now - lastTemp > 20000) {
             onboardTemp = read_onboard_temperature();
-            std::cout << "Onboard temp: " << onboardTemp << "\n";
+            std::cout << "Onboard temp: ";
+            weather_station::writeCenti(std::cout, onboardTemp);
+            std::cout << "\n";
             lastTemp = now;
         }
 
-        bool haveData = lastReady != 0;
-
-        if (haveData && (now - lastWeatherReport > 60000 * 5 || lastWeatherReport == 0)) {
-            lastWeatherReport = now;
-            mqtt.ReportWeather(weather.CO2(), weather.temperature(), weather.humidity());
+#ifdef MQTT_SOAK
+        soak(mqtt, weather, now);
+#endif
+#ifdef PEER_ONLY
+        bool mqttAccepting = true;
+#else
+        // A report or backlog replay in flight holds the next report back, it stays due until MQTT can take it
+        bool mqttAccepting = mqtt.Accepting();
+#endif
+        if (weather.reportDue(now) && !radio.live()) {
+            // Radio is duty cycled, the next wake publishes it from the log
+            weather_station::FaultInjector::reportDue();
+            flashLog.append(weather.measurement(), weather.measurementTime());
+            weather.reported(now);
+        } else if (weather.reportDue(now) && mqttAccepting) {
+            weather_station::FaultInjector::reportDue();
+            auto measurement = weather.measurement();
+            auto sequence = flashLog.append(measurement, weather.measurementTime());
+            auto timestamp = weather_station::Clock::toUtc(weather.measurementTime());
+            bool accepted = true;
+#ifndef PEER_ONLY
+            accepted = mqtt.ReportWeather(measurement, weather.windowStats(), timestamp, sequence, weather.readings());
+#endif
+#ifdef PUSH_SERVER
+            push.addWeather(measurement, timestamp);
+#endif
+#ifdef UDP_SERVER
+#ifdef PEER_ONLY
+            // The log only numbers the readings for the gateway, nothing acknowledges a datagram and there is no
+            // broker to replay to, so a reading lwIP took is as delivered as it gets
+            if (udp.reportWeather(measurement, timestamp, sequence)) {
+                flashLog.markSent(sequence);
+            }
+#else
+            udp.reportWeather(measurement, timestamp, sequence);
+#endif
+#endif
+            // A skipped report stays in the log for the backlog replay, the window is reported with the next one
+            if (accepted) {
+                weather.reported(now);
+            }
+        } else if (mqtt.Ready() && flashLog.hasUnsent()) {
+            replayBacklog(mqtt, flashLog);
         }
+        flashLog.process(now);
+        radio.process(now);
+#ifdef GATEWAY_PORT
+        gateway.process(now, mqtt);
+#endif
+#ifdef PUSH_SERVER
+        push.process(now);
+#endif
+        weather_station::FaultInjector::process(now, mqtt);
+        // Measured before idling, which is waiting on purpose
+        weather_station::FaultInjector::loop(time_us_64() - loopStart);
+        power.idle(now);
     }
 }
 
+
 int main()
 {
     stdio_init_all();
     sleep_ms(2000);
     std::cout << "Start!\n";
+#ifdef BENCHMARK
+    // Nothing else runs, so interrupts and the other core do not disturb the timings
+    for (;;) {
+        weather_station::runBenchmarks();
+        sleep_ms(10000);
+    }
+#endif
+    weather_station::initChannel();
     multicore_launch_core1(displayThread);
     processingThread();
 }
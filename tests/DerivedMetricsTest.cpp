@@ -0,0 +1,69 @@
+#include "DerivedMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+using namespace weather_station;
+
+namespace
+{
+// The Magnus formula and NWS heat index in double precision with libm
+struct Reference
+{
+    double dewPoint;
+    double absoluteHumidity;
+    double heatIndex;
+};
+
+Reference reference(double temperature, double humidity)
+{
+    double gamma = std::log(humidity / 100) + 17.62 * temperature / (243.12 + temperature);
+    double t = temperature * 9 / 5 + 32;
+    double index = 0.5 * (t + 61 + (t - 68) * 1.2 + humidity * 0.094);
+    if ((index + t) / 2 >= 80) {
+        double r = humidity;
+        index = -42.379 + 2.04901523 * t + 10.14333127 * r - .22475541 * t * r - .00683783 * t * t -
+                .05481717 * r * r + .00122874 * t * t * r + .00085282 * t * r * r - .00000199 * t * t * r * r;
+        if (r < 13 && t > 80 && t < 112) {
+            index -= ((13 - r) / 4) * std::sqrt((17 - std::fabs(t - 95)) / 17);
+        } else if (r > 85 && t > 80 && t < 87) {
+            index += ((r - 85) / 10) * ((87 - t) / 5);
+        }
+    }
+    return {
+        243.12 * gamma / (17.62 - gamma), 216.7 * 6.112 * std::exp(gamma) / (273.15 + temperature),
+        (index - 32) * 5 / 9
+    };
+}
+
+bool check(const char* metric, double error, double bound)
+{
+    bool ok = error < bound;
+    std::cout << metric << " max error " << error << (ok ? " < " : " >= ") << bound << "\n";
+    return ok;
+}
+} // namespace
+
+// Sweeps -20..50 C and 5..100 % and checks the bounds given in DerivedMetrics.h
+int main()
+{
+    double dewPoint = 0;
+    double absoluteHumidity = 0;
+    double heatIndex = 0;
+    for (int32_t temperature = -2000; temperature <= 5000; ++temperature) {
+        for (int32_t humidity = 500; humidity <= 10000; humidity += 5) {
+            auto fixed = DerivedMetrics::compute(temperature, humidity);
+            auto expected = reference(temperature / 100.0, humidity / 100.0);
+            dewPoint = std::max(dewPoint, std::fabs(fixed.dewPoint / 100.0 - expected.dewPoint));
+            absoluteHumidity =
+                std::max(absoluteHumidity, std::fabs(fixed.absoluteHumidity / 100.0 - expected.absoluteHumidity));
+            heatIndex = std::max(heatIndex, std::fabs(fixed.heatIndex / 100.0 - expected.heatIndex));
+        }
+    }
+    bool ok = check("dew point (C)", dewPoint, 0.02);
+    ok = check("absolute humidity (g/m3)", absoluteHumidity, 0.03) && ok;
+    ok = check("heat index (C)", heatIndex, 0.02) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+#include "DhtDecoder.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace weather_station;
+
+namespace
+{
+using Result = DhtDecoder::Result;
+using Data = std::array<uint8_t, 5>;
+
+struct Case
+{
+    int line = 0;
+    Result expected = Result::Ok;
+    Data data = {};
+    DhtDecoder::Trace trace;
+};
+
+uint32_t nextRandom(uint32_t& state)
+{
+    state = state * 1664525 + 1013904223;
+    return state >> 8;
+}
+
+bool checksumValid(const Data& data)
+{
+    return data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF);
+}
+
+// "<result>[ <5 hex bytes>]: <edge times>", see dht_traces.txt
+bool parse(const std::string& text, Case& c)
+{
+    auto colon = text.find(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    std::string expected = text.substr(0, colon);
+    size_t length = 0;
+    for (uint8_t r = 0; r < static_cast<uint8_t>(Result::Count); ++r) {
+        std::string name = DhtDecoder::name(static_cast<Result>(r));
+        if (expected.compare(0, name.size(), name) == 0 &&
+            (expected.size() == name.size() || expected[name.size()] == ' ')) {
+            c.expected = static_cast<Result>(r);
+            length = name.size();
+        }
+    }
+    if (length == 0) {
+        return false;
+    }
+    std::istringstream bytes(expected.substr(length));
+    size_t count = 0;
+    for (unsigned value; bytes >> std::hex >> value; ++count) {
+        if (count == c.data.size() || value > 0xFF) {
+            return false;
+        }
+        c.data[count] = static_cast<uint8_t>(value);
+    }
+    if (count != (c.expected == Result::Ok ? c.data.size() : 0)) {
+        return false;
+    }
+    std::istringstream edges(text.substr(colon + 1));
+    c.trace.count = 0;
+    for (uint32_t time; edges >> time;) {
+        if (c.trace.count == c.trace.edges.size()) {
+            return false;
+        }
+        c.trace.edges[c.trace.count++] = time;
+    }
+    return edges.eof();
+}
+
+// The trace with every pulse stretched or shortened by up to jitter us
+DhtDecoder::Trace jittered(const DhtDecoder::Trace& trace, uint32_t jitter, uint32_t& seed)
+{
+    auto result = trace;
+    for (size_t i = 1; i < trace.count; ++i) {
+        auto pulse = static_cast<int32_t>(trace.edges[i] - trace.edges[i - 1]);
+        pulse += static_cast<int32_t>(nextRandom(seed) % (2 * jitter + 1)) - static_cast<int32_t>(jitter);
+        result.edges[i] = result.edges[i - 1] + std::max(pulse, 1);
+    }
+    return result;
+}
+
+// One random damage to the trace: a lost or an extra edge, a moved edge, a cut or noise on every pulse
+DhtDecoder::Trace mutated(const DhtDecoder::Trace& trace, uint32_t& seed)
+{
+    auto result = trace;
+    auto& e = result.edges;
+    auto& count = result.count;
+    size_t at = count == 0 ? 0 : nextRandom(seed) % count;
+    switch (nextRandom(seed) % 5) {
+        case 0:
+            if (count > 0) {
+                std::copy(e.begin() + at + 1, e.begin() + count, e.begin() + at);
+                --count;
+            }
+            break;
+        case 1:
+            if (count < e.size()) {
+                std::copy_backward(e.begin() + at, e.begin() + count, e.begin() + count + 1);
+                e[at] -= at > 0 ? (e[at] - e[at - 1]) / 2 : 0;
+                ++count;
+            }
+            break;
+        case 2:
+            if (count > 0) {
+                e[at] += nextRandom(seed) % 201 - 100;
+            }
+            break;
+        case 3:
+            count = static_cast<uint8_t>(at);
+            break;
+        default:
+            result = jittered(trace, 40, seed);
+            break;
+    }
+    return result;
+}
+} // namespace
+
+// Replays the frames of the corpus given as argument and checks the result of each, then reports how many of the good
+// frames still decode with more timing noise and checks that damaged frames never decode to data with a wrong
+// checksum
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <traces>\n";
+        return 2;
+    }
+    std::ifstream file(argv[1]);
+    if (!file) {
+        std::cerr << "cannot open " << argv[1] << "\n";
+        return 2;
+    }
+    std::vector<Case> cases;
+    std::string text;
+    for (int line = 1; std::getline(file, text); ++line) {
+        if (text.empty() || text[0] == '#') {
+            continue;
+        }
+        Case c;
+        c.line = line;
+        if (!parse(text, c)) {
+            std::cerr << argv[1] << ":" << line << ": cannot parse\n";
+            return 2;
+        }
+        cases.push_back(c);
+    }
+
+    bool ok = true;
+    for (const auto& c : cases) {
+        Data data;
+        auto result = DhtDecoder::decode(c.trace, data);
+        if (result != c.expected || (result == Result::Ok && data != c.data)) {
+            std::cout << argv[1] << ":" << c.line << ": expected " << DhtDecoder::name(c.expected) << ", got "
+                      << DhtDecoder::name(result) << "\n";
+            ok = false;
+        }
+    }
+    std::cout << cases.size() << " frames replayed\n";
+
+    // Noise on top of the recorded timing, up to +-5 us every good frame has to survive
+    for (uint32_t jitter : {5, 10, 15, 20, 25}) {
+        constexpr int variants = 1000;
+        uint32_t seed = jitter;
+        int frames = 0;
+        int decoded = 0;
+        for (const auto& c : cases) {
+            if (c.expected != Result::Ok) {
+                continue;
+            }
+            for (int i = 0; i < variants; ++i, ++frames) {
+                Data data;
+                if (DhtDecoder::decode(jittered(c.trace, jitter, seed), data) == Result::Ok && data == c.data) {
+                    ++decoded;
+                }
+            }
+        }
+        std::cout << "jitter +-" << jitter << " us: " << decoded * 100.0 / frames << " % decoded\n";
+        if (jitter <= 5 && decoded != frames) {
+            ok = false;
+        }
+    }
+
+    constexpr int mutations = 20000;
+    uint32_t seed = 43;
+    int results[static_cast<size_t>(Result::Count) + 1] = {};
+    for (const auto& c : cases) {
+        for (int i = 0; i < mutations; ++i) {
+            Data data;
+            auto result = DhtDecoder::decode(mutated(c.trace, seed), data);
+            ++results[std::min(static_cast<size_t>(result), static_cast<size_t>(Result::Count))];
+            if (result >= Result::Count || (result == Result::Ok && !checksumValid(data))) {
+                std::cout << "mutation of line " << c.line << " decoded to " << static_cast<int>(result) << "\n";
+                ok = false;
+            }
+        }
+    }
+    std::cout << "mutated frames:";
+    for (uint8_t r = 0; r < static_cast<uint8_t>(Result::Count); ++r) {
+        std::cout << " " << DhtDecoder::name(static_cast<Result>(r)) << " " << results[r] << ",";
+    }
+    std::cout << " invalid " << results[static_cast<size_t>(Result::Count)] << "\n";
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+#include "FakeBroker.h"
+
+#include "lwip/apps/mqtt_priv.h"
+#include "lwip/timeouts.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+struct altcp_pcb
+{
+    mqtt_client_t* client;
+};
+
+namespace fake_sdk
+{
+namespace
+{
+struct Session
+{
+    mqtt_client_t client{};
+    altcp_pcb pcb{&client};
+    mqtt_connection_cb_t onConnection = nullptr;
+    void* connectionArg = nullptr;
+    mqtt_incoming_publish_cb_t onPublish = nullptr;
+    mqtt_incoming_data_cb_t onData = nullptr;
+    void* publishArg = nullptr;
+    std::vector<std::string> subscriptions;
+    // Counts closed connections, an answer for an earlier one is dropped
+    uint32_t connection = 0;
+};
+
+struct Answer
+{
+    uint64_t dueMs;
+    Session* session;
+    uint32_t connection;
+    std::function<void()> deliver;
+};
+
+// Clients are never freed by the firmware, the broker keeps them like lwIP's pool would
+std::vector<std::unique_ptr<Session>> sessions;
+std::vector<Answer> answers;
+
+Session& session(mqtt_client_t* client)
+{
+    return **std::find_if(sessions.begin(), sessions.end(), [&](const auto& s) { return &s->client == client; });
+}
+
+void answer(Session& session, std::function<void()> deliver)
+{
+    answers.push_back({time_us_64() / 1000 + broker.latencyMs, &session, session.connection, std::move(deliver)});
+}
+
+void close(Session& session)
+{
+    session.client.conn = nullptr;
+    session.subscriptions.clear();
+    ++session.connection;
+}
+
+void deliverAnswers()
+{
+    for (;;) {
+        auto due = std::min_element(answers.begin(), answers.end(), [](const Answer& a, const Answer& b) {
+            return a.dueMs < b.dueMs;
+        });
+        if (due == answers.end() || due->dueMs > time_us_64() / 1000) {
+            return;
+        }
+        auto next = std::move(*due);
+        answers.erase(due);
+        if (next.connection == next.session->connection) {
+            next.deliver();
+        }
+    }
+}
+} // namespace
+
+void Broker::publish(const std::string& topic, const std::string& payload)
+{
+    for (auto& s : sessions) {
+        auto& subscriptions = s->subscriptions;
+        if (!s->client.conn || std::find(subscriptions.begin(), subscriptions.end(), topic) == subscriptions.end()) {
+            continue;
+        }
+        answer(*s, [s = s.get(), topic, payload]() {
+            s->onPublish(s->publishArg, topic.c_str(), payload.size());
+            s->onData(
+                s->publishArg, reinterpret_cast<const u8_t*>(payload.data()), payload.size(), MQTT_DATA_FLAG_LAST
+            );
+        });
+    }
+}
+
+void advance(uint64_t ms)
+{
+    for (uint64_t i = 0; i < ms; ++i) {
+        timeUs += 1000;
+        deliverAnswers();
+        runTimeouts();
+    }
+}
+} // namespace fake_sdk
+
+using fake_sdk::broker;
+using fake_sdk::Session;
+
+mqtt_client_t* mqtt_client_new()
+{
+    fake_sdk::sessions.push_back(std::make_unique<Session>());
+    return &fake_sdk::sessions.back()->client;
+}
+
+err_t mqtt_client_connect(
+    mqtt_client_t* client, const ip_addr_t*, u16_t, mqtt_connection_cb_t cb, void* arg,
+    const mqtt_connect_client_info_t*
+)
+{
+    auto& session = fake_sdk::session(client);
+    if (client->conn) {
+        return ERR_ISCONN;
+    }
+    session.onConnection = cb;
+    session.connectionArg = arg;
+    fake_sdk::answer(session, [&session]() {
+        session.client.conn = &session.pcb;
+        ++broker.connects;
+        session.onConnection(&session.client, session.connectionArg, MQTT_CONNECT_ACCEPTED);
+    });
+    return ERR_OK;
+}
+
+void mqtt_disconnect(mqtt_client_t* client)
+{
+    fake_sdk::close(fake_sdk::session(client));
+}
+
+void altcp_abort(altcp_pcb* conn)
+{
+    auto& session = fake_sdk::session(conn->client);
+    fake_sdk::close(session);
+    ++broker.resets;
+    session.onConnection(&session.client, session.connectionArg, MQTT_CONNECT_DISCONNECTED);
+}
+
+void mqtt_set_inpub_callback(
+    mqtt_client_t* client, mqtt_incoming_publish_cb_t pub_cb, mqtt_incoming_data_cb_t data_cb, void* arg
+)
+{
+    auto& session = fake_sdk::session(client);
+    session.onPublish = pub_cb;
+    session.onData = data_cb;
+    session.publishArg = arg;
+}
+
+err_t mqtt_sub_unsub(mqtt_client_t* client, const char* topic, u8_t, mqtt_request_cb_t cb, void* arg, u8_t sub)
+{
+    auto& session = fake_sdk::session(client);
+    if (!client->conn) {
+        return ERR_CONN;
+    }
+    auto& subscriptions = session.subscriptions;
+    subscriptions.erase(std::remove(subscriptions.begin(), subscriptions.end(), topic), subscriptions.end());
+    if (sub) {
+        subscriptions.push_back(topic);
+    }
+    if (cb) {
+        fake_sdk::answer(session, [cb, arg]() { cb(arg, ERR_OK); });
+    }
+    return ERR_OK;
+}
+
+err_t mqtt_publish(
+    mqtt_client_t* client, const char* topic, const void* payload, u16_t payload_length, u8_t qos, u8_t,
+    mqtt_request_cb_t cb, void* arg
+)
+{
+    auto& session = fake_sdk::session(client);
+    if (!client->conn) {
+        return ERR_CONN;
+    }
+    broker.messages.push_back({topic, std::string(static_cast<const char*>(payload), payload_length), qos});
+    // PUBACK for QoS 1 and 2, the segment being sent for QoS 0
+    if (cb) {
+        fake_sdk::answer(session, [cb, arg]() { cb(arg, ERR_OK); });
+    }
+    return ERR_OK;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "lwip/apps/mqtt.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fake_sdk
+{
+// Minimal MQTT broker in the test process behind the lwIP MQTT client API of tests/sdk. CONNACK, SUBACK, PUBACK and
+// PUBLISHes to subscribers arrive latencyMs after the request, like over the loopback interface. Answers for a
+// connection that was closed in the meantime are dropped, as lwIP drops the requests of a closed connection.
+struct Broker
+{
+    struct Message
+    {
+        std::string topic;
+        std::string payload;
+        uint8_t qos;
+    };
+
+    uint32_t latencyMs = 1;
+    uint32_t connects = 0;
+    uint32_t resets = 0;
+    std::vector<Message> messages;
+
+    // Sends payload to the clients subscribed to topic
+    void publish(const std::string& topic, const std::string& payload);
+};
+
+inline Broker broker;
+
+// Moves the fake clock on by ms a millisecond at a time, delivering the broker's answers and running the lwIP timeouts
+// as they fall due
+void advance(uint64_t ms);
+} // namespace fake_sdk
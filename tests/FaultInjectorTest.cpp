@@ -0,0 +1,152 @@
+#include "FakeBroker.h"
+#include "FaultInjector.h"
+#include "I2CBus.h"
+#include "MQTT.h"
+#include "SCD.h"
+
+#include <hardware/sync.h>
+#include <pico/time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace weather_station;
+
+namespace
+{
+constexpr uint64_t second = 1000;
+// Active and recovery phase of every scenario, see FaultInjector.cpp
+constexpr uint64_t phase = 300 * second;
+constexpr uint64_t scenarioCount = 8;
+constexpr uint64_t i2cScenario = 1;
+constexpr uint64_t reportInterval = 10 * second;
+// The longest the emulated sensor goes without a sample on its own faults, see ScdRecoveryTest.cpp
+constexpr uint64_t maxScdGap = 27 * second;
+
+bool failed = false;
+
+void expect(bool condition, const char* what)
+{
+    if (!condition) {
+        std::cout << "FAILED: " << what << "\n";
+        failed = true;
+    }
+}
+
+struct Scenario
+{
+    bool found = false;
+    uint32_t injected = 0;
+    uint32_t delivered = 0;
+    uint32_t due = 0;
+};
+
+// "  <name>: <injected> injected, <delivered>/<due> reports delivered, ..." of the report
+Scenario parse(const std::string& report, const std::string& name)
+{
+    Scenario scenario;
+    auto at = report.find("  " + name + ": ");
+    if (at == std::string::npos) {
+        return scenario;
+    }
+    std::istringstream line(report.substr(at + name.size() + 4));
+    std::string injected;
+    char slash;
+    scenario.found = line >> scenario.injected >> injected >> scenario.delivered >> slash >> scenario.due &&
+                     injected == "injected," && slash == '/';
+    return scenario;
+}
+} // namespace
+
+// One round of all fault scenarios with the SCD driver on the emulated sensor and MQTT reports to the broker stub, the
+// main loop of main.cpp on the fake clock. A second thread plays core 1 and rolls DHT glitches at the same time as
+// core 0, the report has to count the faults injected on both.
+int main()
+{
+    std::ostringstream log;
+    auto* out = std::cout.rdbuf(log.rdbuf());
+    auto* errors = std::cerr.rdbuf(log.rdbuf());
+
+    MQTT mqtt;
+    mqtt.SetDeliveryCallback([](uint32_t first, uint32_t last) { FaultInjector::delivered(last - first + 1); });
+    mqtt.Connect();
+    fake_sdk::advance(100);
+    SCD scd(0);
+
+    std::atomic<bool> running = true;
+    uint32_t core1Glitches = 0;
+    std::thread core1([&] {
+        fake_sdk::core = 1;
+        while (running) {
+            core1Glitches += FaultInjector::fail(FaultInjector::Fault::DhtGlitch);
+            std::this_thread::yield();
+        }
+    });
+
+    uint32_t core0Glitches = 0;
+    uint32_t sequence = 0;
+    std::vector<uint64_t> samples;
+    auto start = time_us_64() / 1000;
+    auto lastReport = start;
+    for (auto now = start; now < start + 2 * phase * scenarioCount + 60 * second; now = time_us_64() / 1000) {
+        auto loopStart = time_us_64();
+        if (scd.process()) {
+            samples.push_back(now);
+        }
+        core0Glitches += FaultInjector::fail(FaultInjector::Fault::DhtGlitch);
+        if (now - lastReport >= reportInterval && mqtt.Accepting()) {
+            FaultInjector::reportDue();
+            mqtt.ReportWeather(scd.GetMeasurement(), WindowStats{}, 0, ++sequence);
+            lastReport = now;
+        }
+        FaultInjector::process(now, mqtt);
+        // Blocking SCD restarts are what moves the clock within an iteration
+        FaultInjector::loop(time_us_64() - loopStart);
+        fake_sdk::advance(1);
+        I2CBus::processAll();
+    }
+    running = false;
+    core1.join();
+    std::cout.rdbuf(out);
+    std::cerr.rdbuf(errors);
+
+    // The SCD restarts block for a while, the phases end a little later than their nominal time
+    auto report = log.str();
+    report = report.substr(std::min(report.find("Fault injection report"), report.size()));
+    report = report.substr(0, report.find("Fault injection:"));
+    std::cout << report;
+    for (const char* name : {"baseline", "i2c errors", "dht glitches", "link drops", "dns failures", "broker resets",
+                             "pbuf exhaustion", "slow fifo consumer"}) {
+        auto scenario = parse(report, name);
+        expect(scenario.found, name);
+        expect(scenario.due > 0 && scenario.delivered > 0, "reports due and delivered in every scenario");
+    }
+    auto baseline = parse(report, "baseline");
+    expect(baseline.delivered == baseline.due, "every report delivered without faults");
+
+    auto glitches = parse(report, "dht glitches");
+    std::cout << "dht glitches: " << core0Glitches << " on core 0, " << core1Glitches << " on core 1\n";
+    expect(core0Glitches > 0 && core1Glitches > 0, "glitches on both cores");
+    expect(glitches.injected == core0Glitches + core1Glitches, "glitches of both cores counted");
+
+    // Once the I2C errors stop the SCD delivers again as it does on the emulator's own faults
+    expect(parse(report, "i2c errors").injected > 0, "i2c errors injected");
+    auto recoveryStart = start + (2 * i2cScenario + 1) * phase;
+    auto previous = recoveryStart;
+    uint64_t longest = 0;
+    for (auto sample : samples) {
+        if (sample > recoveryStart && sample < recoveryStart + phase) {
+            longest = std::max(longest, sample - previous);
+            previous = sample;
+        }
+    }
+    std::cout << "SCD after the i2c errors: longest " << longest / second << " s without a sample\n";
+    expect(previous > recoveryStart && longest <= maxScdGap, "SCD recovers from the i2c errors");
+    return failed ? 1 : 0;
+}
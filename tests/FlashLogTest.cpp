@@ -0,0 +1,168 @@
+#include "Clock.h"
+#include "FlashLog.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+using namespace weather_station;
+
+// The firmware image ends before the fake flash, so the whole log region is free
+char __flash_binary_end;
+
+uint64_t Clock::toUtc(uint64_t monotonicUs)
+{
+    return monotonicUs;
+}
+
+namespace
+{
+constexpr uint32_t recordsPerPage = FLASH_PAGE_SIZE / sizeof(FlashLog::Record);
+constexpr uint32_t recordsPerSector = FLASH_SECTOR_SIZE / sizeof(FlashLog::Record);
+constexpr uint32_t totalRecords = 32 * recordsPerSector;
+
+bool failed = false;
+
+void expect(bool condition, const char* what)
+{
+    if (!condition) {
+        std::cout << "FAILED: " << what << "\n";
+        failed = true;
+    }
+}
+
+uint32_t append(FlashLog& log, uint32_t i)
+{
+    Measurement measurement;
+    measurement.CO2 = static_cast<uint16_t>(400 + i % 1000);
+    measurement.Temperature = static_cast<int16_t>(2000 + i % 500);
+    measurement.Humidity = static_cast<uint16_t>(4000 + i % 2000);
+    measurement.Valid = Measurement::HasTemperature | Measurement::HasHumidity | Measurement::HasCO2;
+    fake_sdk::timeUs += 1000000;
+    return log.append(measurement, fake_sdk::timeUs);
+}
+
+std::vector<uint32_t> unsent(const FlashLog& log)
+{
+    std::vector<uint32_t> sequences;
+    log.forEachUnsent([&](const FlashLog::Record& record) { sequences.push_back(record.sequence); }, totalRecords);
+    return sequences;
+}
+
+// Sequences first..last
+std::vector<uint32_t> sequence(uint32_t first, uint32_t last)
+{
+    std::vector<uint32_t> sequences;
+    for (uint32_t s = first; s <= last; ++s) {
+        sequences.push_back(s);
+    }
+    return sequences;
+}
+
+// A page fills while the watermark has not been persisted yet, the Sent marker goes to the start of the next page
+void pageFillsWithUnpersistedWatermark()
+{
+    std::fill(fake_sdk::flash.begin(), fake_sdk::flash.end(), 0xFF);
+    {
+        FlashLog log;
+        for (uint32_t i = 0; i < recordsPerPage - 1; ++i) {
+            append(log, i);
+        }
+        log.markSent(5);
+        expect(append(log, recordsPerPage) == recordsPerPage, "last record of the page");
+        expect(log.sent() == 5, "watermark kept while the page rolls over");
+        expect(unsent(log) == sequence(6, recordsPerPage), "unsent records of the programmed page");
+        log.flush();
+        append(log, recordsPerPage + 1);
+        log.flush();
+    }
+    // After a reboot: the full page, the marker and one more measurement
+    FlashLog log;
+    expect(log.sent() == 5, "watermark persisted");
+    expect(log.lastMeasurement() == recordsPerPage + 2, "measurement after the marker");
+    auto expected = sequence(6, recordsPerPage);
+    expected.push_back(recordsPerPage + 2);
+    expect(unsent(log) == expected, "unsent records after a reboot");
+}
+
+// The same when the page that fills is the last one and the log wraps to the first
+void logWrapsWithUnpersistedWatermark()
+{
+    std::fill(fake_sdk::flash.begin(), fake_sdk::flash.end(), 0xFF);
+    {
+        FlashLog log;
+        for (uint32_t i = 0; i < totalRecords - 1; ++i) {
+            append(log, i);
+        }
+        log.markSent(totalRecords - 3);
+        expect(append(log, totalRecords) == totalRecords, "last record of the region");
+        log.flush();
+    }
+    FlashLog log;
+    expect(log.sent() == totalRecords - 3, "watermark persisted after the wrap");
+    expect(log.lastMeasurement() == totalRecords, "newest measurement after the wrap");
+    expect(unsent(log) == sequence(totalRecords - 2, totalRecords), "unsent records after the wrap");
+    expect(append(log, 0) == totalRecords + 2, "sequence continues after the wrap");
+}
+
+// A reboot at a page boundary inside a sector continues on the next page and keeps the earlier ones
+void resumeAtPageBoundary()
+{
+    std::fill(fake_sdk::flash.begin(), fake_sdk::flash.end(), 0xFF);
+    {
+        FlashLog log;
+        for (uint32_t i = 0; i < 2 * recordsPerPage; ++i) {
+            append(log, i);
+        }
+        log.flush();
+    }
+    auto erased = fake_sdk::sectorsErased;
+    {
+        FlashLog log;
+        expect(fake_sdk::sectorsErased == erased, "no erase when resuming inside a sector");
+        expect(unsent(log) == sequence(1, 2 * recordsPerPage), "pages before the reboot kept");
+        append(log, 0);
+        log.flush();
+    }
+    FlashLog log;
+    expect(unsent(log) == sequence(1, 2 * recordsPerPage + 1), "record after the reboot on the next page");
+}
+
+// Wrapping into a sector of unsent measurements drops them, the scans continue with the oldest ones left. Marking
+// some as sent moves the start of the scans past them, also across a reboot.
+void wrapDropsUnsent()
+{
+    std::fill(fake_sdk::flash.begin(), fake_sdk::flash.end(), 0xFF);
+    {
+        FlashLog log;
+        for (uint32_t i = 0; i < totalRecords + recordsPerPage; ++i) {
+            append(log, i);
+        }
+        expect(unsent(log) == sequence(recordsPerSector + 1, totalRecords + recordsPerPage), "oldest sector dropped");
+        log.markSent(recordsPerSector + 10);
+        expect(
+            unsent(log) == sequence(recordsPerSector + 11, totalRecords + recordsPerPage), "unsent after the watermark"
+        );
+        log.markSent(totalRecords + 1);
+        expect(unsent(log) == sequence(totalRecords + 2, totalRecords + recordsPerPage), "watermark after the wrap");
+        log.flush();
+    }
+    FlashLog log;
+    expect(unsent(log) == sequence(totalRecords + 2, totalRecords + recordsPerPage), "unsent after a reboot");
+    log.markSent(totalRecords + recordsPerPage);
+    expect(unsent(log).empty(), "all sent");
+    expect(append(log, 0) == totalRecords + recordsPerPage + 2, "sequence after the marker");
+    expect(unsent(log) == sequence(totalRecords + recordsPerPage + 2, totalRecords + recordsPerPage + 2), "new record");
+}
+} // namespace
+
+int main()
+{
+    pageFillsWithUnpersistedWatermark();
+    logWrapsWithUnpersistedWatermark();
+    resumeAtPageBoundary();
+    wrapDropsUnsent();
+    std::cout << fake_sdk::pagesProgrammed << " pages programmed, " << fake_sdk::sectorsErased << " sectors erased\n";
+    return failed ? 1 : 0;
+}
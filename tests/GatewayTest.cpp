@@ -0,0 +1,146 @@
+#include "FakeBroker.h"
+#include "Gateway.h"
+#include "MQTT.h"
+
+#include <pico/time.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace weather_station;
+
+namespace
+{
+constexpr uint16_t port = 5555;
+constexpr uint32_t maxPeers = 16;
+
+bool failed = false;
+
+void expect(bool condition, const char* what)
+{
+    if (!condition) {
+        std::cout << "FAILED: " << what << "\n";
+        failed = true;
+    }
+}
+
+// Station names are unique per test case, so peers of earlier cases do not interfere
+void send(const std::string& station, uint32_t sequence)
+{
+    PeerReading reading;
+    memcpy(reading.station.data(), station.data(), std::min(station.size(), reading.station.size() - 1));
+    reading.sequence = sequence;
+    reading.co2 = 400;
+    fake_sdk::udpReceive(port, &reading, sizeof(reading));
+    fake_sdk::advance(1);
+}
+
+// "station,sequence" of every reading the gateway forwarded since the last call
+std::vector<std::string> forwarded(Gateway& gateway, MQTT& mqtt)
+{
+    std::vector<std::string> readings;
+    for (int i = 0; i < 20; ++i) {
+        fake_sdk::advance(10000);
+        gateway.process(time_us_64() / 1000, mqtt);
+    }
+    fake_sdk::advance(100);
+    for (const auto& message : fake_sdk::broker.messages) {
+        if (message.topic != "home/weather_station/peers") {
+            continue;
+        }
+        std::istringstream lines(message.payload);
+        for (std::string line; std::getline(lines, line);) {
+            auto second = line.find(',', line.find(',') + 1);
+            readings.push_back(line.substr(0, second));
+        }
+    }
+    fake_sdk::broker.messages.clear();
+    return readings;
+}
+
+using Readings = std::vector<std::string>;
+
+// Retransmissions and reordering within the 32 sequence window
+void duplicates(Gateway& gateway, MQTT& mqtt)
+{
+    for (uint32_t sequence : {1, 2, 3, 2, 3, 1, 10, 8, 9, 8, 10}) {
+        send("dup", sequence);
+    }
+    expect(forwarded(gateway, mqtt) == Readings{"dup,1", "dup,2", "dup,3", "dup,10", "dup,8", "dup,9"}, "duplicates");
+
+    // Older than the window: not tracked any more, taken for a duplicate
+    send("dup", 50);
+    send("dup", 18);
+    send("dup", 19);
+    expect(forwarded(gateway, mqtt) == Readings{"dup,50", "dup,19"}, "outside the window");
+
+    // Peers without a flash log send sequence 0, nothing to deduplicate on
+    send("nolog", 0);
+    send("nolog", 0);
+    expect(forwarded(gateway, mqtt) == Readings{"nolog,0", "nolog,0"}, "sequence 0");
+}
+
+// A peer that lost its flash log starts over at 1, far behind the newest sequence seen
+void restart(Gateway& gateway, MQTT& mqtt)
+{
+    send("restart", 5000);
+    send("restart", 4999);
+    send("restart", 1);
+    send("restart", 2);
+    send("restart", 1);
+    send("restart", 2);
+    expect(forwarded(gateway, mqtt) == Readings{"restart,5000", "restart,4999", "restart,1", "restart,2"}, "restart");
+}
+
+// With every slot taken, a new station takes the one not heard from the longest, which forgets its sequences
+void eviction(Gateway& gateway, MQTT& mqtt)
+{
+    for (uint32_t i = 0; i < maxPeers; ++i) {
+        send("evict" + std::to_string(i), 7);
+    }
+    forwarded(gateway, mqtt);
+    send("evict1", 8);
+    send("newcomer", 1);
+    send("evict0", 7);
+    send("evict1", 7);
+    send("evict1", 8);
+    expect(forwarded(gateway, mqtt) == Readings{"evict1,8", "newcomer,1", "evict0,7"}, "eviction");
+}
+
+// Wrong size, magic or version are counted and dropped
+void malformed(Gateway& gateway, MQTT& mqtt)
+{
+    PeerReading reading;
+    reading.header = 0x1234;
+    fake_sdk::udpReceive(port, &reading, sizeof(reading));
+    reading = PeerReading{};
+    reading.version = 2;
+    fake_sdk::udpReceive(port, &reading, sizeof(reading));
+    fake_sdk::udpReceive(port, "weather", 7);
+    expect(forwarded(gateway, mqtt).empty(), "malformed datagrams dropped");
+}
+} // namespace
+
+// Gateway::accept through the gateway's UDP port, forwarding to the broker stub
+int main()
+{
+    MQTT mqtt;
+    Gateway gateway(port);
+    fake_sdk::advance(1);
+    expect(gateway.start(), "gateway started");
+    mqtt.Connect();
+    fake_sdk::advance(100);
+    expect(mqtt.Ready(), "connected");
+
+    duplicates(gateway, mqtt);
+    restart(gateway, mqtt);
+    eviction(gateway, mqtt);
+    malformed(gateway, mqtt);
+    gateway.printStats(time_us_64() / 1000);
+    return failed ? 1 : 0;
+}
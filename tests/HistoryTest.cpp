@@ -0,0 +1,113 @@
+#include "History.h"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+using namespace weather_station;
+
+namespace
+{
+constexpr uint64_t second = 1000;
+constexpr uint64_t minute = 60 * second;
+
+bool failed = false;
+
+void expect(bool condition, const char* what)
+{
+    if (!condition) {
+        std::cout << "FAILED: " << what << "\n";
+        failed = true;
+    }
+}
+
+// The temperature of every sample is the second it was taken at divided by scale, so each point shows where its time
+// came from
+void addSeconds(History& history, uint64_t& now, uint64_t seconds, uint64_t scale = 1)
+{
+    for (uint64_t i = 0; i < seconds; ++i, now += second) {
+        Measurement measurement;
+        measurement.Temperature = static_cast<int16_t>(now / second / scale);
+        measurement.Valid = Measurement::HasTemperature;
+        history.add(now, measurement);
+    }
+}
+
+// Points are in time order and each value was taken at most maxAge seconds before its time: minute and quarter means
+// lag behind the end of their period, which may lie in the gap. Nothing else falls into the gap.
+void checkPoints(
+    const History& history, uint64_t gapStart, uint64_t gapEnd, int32_t maxAge, const char* what, int32_t scale = 1
+)
+{
+    uint64_t previous = 0;
+    size_t points = 0;
+    bool ordered = true;
+    bool outsideGap = true;
+    bool timely = true;
+    history.forEach(0, [&](uint64_t time, const HistoryPoint& point) {
+        ordered = ordered && time > previous;
+        outsideGap = outsideGap && (time < gapStart + maxAge * second || time >= gapEnd);
+        auto age = static_cast<int32_t>(time / second) / scale - point[1];
+        timely = timely && age >= 0 && age <= maxAge / scale + 1;
+        previous = time;
+        ++points;
+    });
+    std::cout << what << ": " << points << " points\n";
+    expect(points > 0, what);
+    expect(ordered, "points in time order");
+    expect(outsideGap, "no points in the gap");
+    expect(timely, "values match the times of their points");
+}
+
+// A 2 minute stall within the seconds tier: every sample keeps the time it was taken at
+void shortGap()
+{
+    auto history = std::make_unique<History>();
+    uint64_t now = 1000 * second;
+    addSeconds(*history, now, 5 * 60);
+    auto gapStart = now;
+    now += 2 * minute;
+    auto gapEnd = now;
+    addSeconds(*history, now, 2 * 60);
+    checkPoints(*history, gapStart, gapEnd, 0, "2 min gap");
+
+    size_t before = 0;
+    history->forEach(0, [&](uint64_t time, const HistoryPoint&) { before += time < gapStart; });
+    expect(before == 5 * 60, "every sample before the gap");
+}
+
+// The same gap with half an hour on either side, so the older part comes from the minutes tier
+void gapInMinutes()
+{
+    auto history = std::make_unique<History>();
+    uint64_t now = 1000 * second;
+    addSeconds(*history, now, 30 * 60 + 17);
+    auto gapStart = now;
+    now += 2 * minute;
+    auto gapEnd = now;
+    addSeconds(*history, now, 30 * 60);
+    checkPoints(*history, gapStart, gapEnd, 60, "2 min gap, 30 min around it");
+}
+
+// A gap longer than the seconds tier and the minutes tier empties them, the older data stays in the quarters
+void longGap()
+{
+    auto history = std::make_unique<History>();
+    uint64_t now = 1000 * second;
+    // In units of 4 s, the seconds of 33 hours do not fit the temperature
+    addSeconds(*history, now, 3 * 3600, 4);
+    auto gapStart = now;
+    now += 30 * 3600 * second;
+    auto gapEnd = now;
+    addSeconds(*history, now, 20 * 60, 4);
+    checkPoints(*history, gapStart, gapEnd, 900, "30 h gap", 4);
+}
+} // namespace
+
+int main()
+{
+    shortGap();
+    gapInMinutes();
+    longGap();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+#include "DerivedMetrics.h"
+#include "DhtDecoder.h"
+#include "Filter.h"
+#include "History.h"
+#include "SensorFilter.h"
+#include "Statistics.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+using namespace weather_station;
+
+namespace
+{
+constexpr int repeats = 7;
+
+// Keeps results alive so the compiler cannot drop the work
+volatile uint32_t sink;
+
+bool first = true;
+
+// The same measurement as the benchmark firmware: runs f iterations times per repeat, drops the first repeat as
+// warm-up and reports the median, min and max nanoseconds per call over the others
+template <typename F>
+void bench(std::string_view name, uint32_t iterations, F&& f)
+{
+    std::array<double, repeats> nsPerOp;
+    for (int r = -1; r < repeats; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            f(i);
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        if (r >= 0) {
+            nsPerOp[r] = elapsed.count() / iterations;
+        }
+    }
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    std::cout << (first ? "" : ",\n") << "{\"name\":\"" << name << "\",\"iterations\":" << iterations
+              << ",\"ns_per_op\":" << nsPerOp[repeats / 2] << ",\"min\":" << nsPerOp.front()
+              << ",\"max\":" << nsPerOp.back() << "}";
+    first = false;
+}
+
+uint32_t nextRandom(uint32_t& state)
+{
+    state = state * 1664525 + 1013904223;
+    return state >> 8;
+}
+
+// Temperature around 22.5 in centi-degrees with noise and a spike every 50 samples
+int32_t noisySample(uint32_t i)
+{
+    uint32_t state = i;
+    int32_t noise = static_cast<int32_t>(nextRandom(state) % 21) - 10;
+    return 2250 + noise + (i % 50 == 0 ? 800 : 0);
+}
+
+// A SCD4x measurement around 800 ppm, 22.5 C and 45 % with the same noise and spikes
+Measurement scdSample(uint32_t i)
+{
+    uint32_t state = i;
+    auto noise = static_cast<int32_t>(nextRandom(state) % 41) - 20;
+    Measurement measurement;
+    measurement.CO2 = static_cast<uint16_t>(800 + noise);
+    measurement.Temperature = static_cast<int16_t>(noisySample(i));
+    measurement.Humidity = static_cast<uint16_t>(4500 + noise * 2);
+    measurement.Valid = Measurement::HasTemperature | Measurement::HasHumidity | Measurement::HasCO2;
+    return measurement;
+}
+
+// Edge times of a frame with nominal pulse lengths
+DhtDecoder::Trace dhtFrame(const std::array<uint8_t, 4>& values)
+{
+    std::array<uint8_t, 5> bytes = {values[0], values[1], values[2], values[3]};
+    bytes[4] = bytes[0] + bytes[1] + bytes[2] + bytes[3];
+    DhtDecoder::Trace trace;
+    uint32_t t = 1000;
+    auto edge = [&](uint32_t nominal) {
+        trace.edges[trace.count++] = t;
+        t += nominal;
+    };
+    edge(80);
+    edge(80);
+    for (int bit = 0; bit < 40; ++bit) {
+        bool one = bytes[bit / 8] & (0x80 >> (bit % 8));
+        edge(50);
+        edge(one ? 70 : 27);
+    }
+    edge(50);
+    edge(0);
+    return trace;
+}
+
+template <typename Stage>
+void benchStage(std::string_view name)
+{
+    Stage stage;
+    bench(name, 1000000, [&](uint32_t i) {
+        auto out = stage(noisySample(i));
+        sink = out ? static_cast<uint32_t>(*out) : 0;
+    });
+}
+} // namespace
+
+// Microbenchmarks of the SDK-free code on the host, one JSON document per run like the benchmark firmware. They show
+// the relative cost of changes to the filters, statistics, history and conversions without flashing a board, the
+// paths that depend on the M0+ or the hardware stay in Benchmark.cpp.
+int main()
+{
+    std::cout << "{\"compiler\":\"" << __VERSION__ << "\",\"benchmarks\":[\n";
+
+    benchStage<filter::Range<int32_t, -1000, 6000>>("filter::Range");
+    benchStage<filter::Median<int32_t, 3>>("filter::Median 3");
+    benchStage<filter::Median<int32_t, 7>>("filter::Median 7");
+    benchStage<filter::Hampel<int32_t, 7, 30, 100>>("filter::Hampel 7");
+    benchStage<filter::Ema<int32_t, 50>>("filter::Ema");
+    benchStage<filter::RateLimit<int32_t, 200>>("filter::RateLimit");
+    benchStage<FilterPipeline<
+        int32_t, filter::Range<int32_t, -1000, 6000>, filter::Hampel<int32_t, 7, 30, 100>, filter::Ema<int32_t, 50>>>(
+        "FilterPipeline SCD temperature"
+    );
+    auto filter = SensorFilter::create(SensorConfig::Kind::Scd4x);
+    bench("SensorFilter::apply SCD4x", 1000000, [&](uint32_t i) {
+        auto measurement = scdSample(i);
+        sink = filter->apply(measurement) ? measurement.Temperature : 0;
+    });
+
+    SampleStats sampleStats;
+    bench("SampleStats::add", 1000000, [&](uint32_t i) { sampleStats.add(noisySample(i)); });
+    sink = sampleStats.mean() + sampleStats.stddev();
+    bench("SampleStats report", 1000000, [&](uint32_t) { sink = sampleStats.mean() + sampleStats.stddev(); });
+    RunningStats runningStats;
+    bench("RunningStats::add", 1000000, [&](uint32_t i) { runningStats.add(noisySample(i) * 0.01f); });
+    sink = static_cast<uint32_t>(runningStats.stddev());
+    Histogram histogram;
+    bench("Histogram::add", 1000000, [&](uint32_t i) { histogram.add(i * 2654435761u >> (i % 24)); });
+    bench("Histogram::percentile", 100000, [&](uint32_t i) { sink = histogram.percentile(i % 101); });
+
+    // Every call is one second later, so each one takes a sample and every 60th and 900th also aggregate
+    History history;
+    uint64_t now = 1000;
+    bench("History::add", 100000, [&](uint32_t i) {
+        now += 1000;
+        history.add(now, scdSample(i));
+    });
+    bench("History::forEach 24 h", 100, [&](uint32_t) {
+        uint32_t sum = 0;
+        history.forEach(now - 24 * 3600 * 1000ULL, [&](uint64_t, const HistoryPoint& point) {
+            sum += point[1];
+            return true;
+        });
+        sink = sum;
+    });
+    bench("History::range 24 h", 1000, [&](uint32_t) {
+        sink = history.range(History::Metric::Temperature, now - 24 * 3600 * 1000ULL).max;
+    });
+
+    bench("DerivedMetrics::compute", 1000000, [&](uint32_t i) {
+        auto derived = DerivedMetrics::compute(1500 + i % 2000, 2000 + i * 7 % 8000);
+        sink = derived.dewPoint + derived.absoluteHumidity + derived.heatIndex;
+    });
+
+    auto frame = dhtFrame({45, 0, 23, 0});
+    bench("DhtDecoder::decode", 1000000, [&](uint32_t) {
+        std::array<uint8_t, 5> data;
+        sink = DhtDecoder::decode(frame, data) == DhtDecoder::Result::Ok ? data[0] : 0;
+    });
+
+    std::cout << "\n]}\n";
+}
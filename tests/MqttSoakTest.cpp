@@ -0,0 +1,98 @@
+#include "FakeBroker.h"
+#include "MQTT.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace weather_station;
+
+namespace
+{
+// The same load as soak() in main.cpp: a report every MQTT_SOAK ms and a dropped connection every 100th time
+constexpr uint32_t dropEvery = 100;
+constexpr uint32_t rounds = 3000;
+constexpr uint32_t topicsPerReport = 5;
+
+bool failed = false;
+
+void expect(bool condition, const char* what)
+{
+    if (!condition) {
+        std::cout << "FAILED: " << what << "\n";
+        failed = true;
+    }
+}
+
+Measurement measurement(uint32_t count)
+{
+    Measurement measurement;
+    measurement.CO2 = 400 + count % 400;
+    measurement.Temperature = 2000 + count % 100 * 10;
+    measurement.Humidity = 4000 + count % 200 * 10;
+    measurement.Valid = Measurement::HasTemperature | Measurement::HasHumidity | Measurement::HasCO2;
+    return measurement;
+}
+} // namespace
+
+// MQTT against the broker stub with the latency and loss of MQTT_SOAK_DELAY_MS and MQTT_SOAK_LOSS_PERCENT: every report
+// has to finish, every dropped connection has to come back before the next report is due, and only reports whose
+// publishes all succeeded may be acknowledged to the flash log
+int main()
+{
+    MQTT mqtt;
+    std::vector<uint32_t> delivered;
+    bool contiguous = true;
+    mqtt.SetDeliveryCallback([&](uint32_t first, uint32_t last) {
+        contiguous = contiguous && first == last;
+        delivered.push_back(last);
+    });
+    expect(mqtt.Connect(), "connect");
+    fake_sdk::advance(100);
+    expect(mqtt.Ready(), "connected");
+
+    uint32_t reports = 0;
+    uint32_t drops = 0;
+    uint32_t notReady = 0;
+    for (uint32_t count = 1; count <= rounds; ++count) {
+        fake_sdk::advance(MQTT_SOAK);
+        if (!mqtt.Ready()) {
+            ++notReady;
+            continue;
+        }
+        if (count % dropEvery == 0) {
+            mqtt.DropConnection();
+            ++drops;
+        } else {
+            mqtt.ReportWeather(measurement(count), WindowStats{}, 0, count);
+            ++reports;
+        }
+    }
+    fake_sdk::advance(60000);
+
+    fake_sdk::broker.publish("home/weather_station/cmd", "interval 30");
+    fake_sdk::advance(100);
+    std::string command;
+    expect(mqtt.TakeCommand(command) && command == "interval 30", "command from the broker");
+
+    mqtt.PrintHealth();
+    auto share = static_cast<float>(delivered.size()) / reports;
+    std::cout << reports << " reports, " << delivered.size() << " delivered, " << drops << " connections dropped, "
+              << fake_sdk::broker.messages.size() << " messages at the broker\n";
+
+    expect(mqtt.Ready(), "idle and connected at the end");
+    expect(notReady == 0, "ready for every report");
+    expect(fake_sdk::broker.resets == drops && fake_sdk::broker.connects == drops + 1, "reconnected after every drop");
+    expect(fake_sdk::broker.messages.size() == reports * topicsPerReport, "every topic of every report published");
+    expect(contiguous, "one report per delivery");
+    expect(std::is_sorted(delivered.begin(), delivered.end()), "deliveries in order");
+    // A report is delivered only if none of its publishes was lost
+    float expected = 1;
+    for (uint32_t i = 0; i < topicsPerReport; ++i) {
+        expected *= 1 - MQTT_SOAK_LOSS_PERCENT / 100.0f;
+    }
+    expect(share > expected - 0.05f && share < expected + 0.05f, "share of delivered reports matches the loss");
+    return failed ? 1 : 0;
+}
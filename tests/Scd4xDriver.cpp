@@ -0,0 +1,100 @@
+#include "embedded-i2c-scd4x/scd4x_i2c.h"
+#include "embedded-i2c-scd4x/sensirion_common.h"
+#include "embedded-i2c-scd4x/sensirion_i2c_hal.h"
+
+#include <array>
+
+// Host stand-in for the Sensirion SCD4x driver: a command is its two bytes written to the sensor, then the execution
+// time, then the response words with their CRCs if there are any. Errors are the HAL's, a CRC mismatch is 1.
+namespace
+{
+constexpr uint8_t address = 0x62;
+
+int16_t command(uint16_t code, uint32_t executionMs)
+{
+    std::array<uint8_t, 2> buffer = {static_cast<uint8_t>(code >> 8), static_cast<uint8_t>(code)};
+    auto error = sensirion_i2c_hal_write(address, buffer.data(), buffer.size());
+    if (error) {
+        return error;
+    }
+    sensirion_i2c_hal_sleep_usec(executionMs * 1000);
+    return 0;
+}
+
+int16_t read(uint16_t* words, uint16_t count)
+{
+    std::array<uint8_t, 9> buffer = {};
+    auto error = sensirion_i2c_hal_read(address, buffer.data(), count * 3);
+    if (error) {
+        return error;
+    }
+    for (uint16_t i = 0; i < count; ++i) {
+        const auto* word = &buffer[i * 3];
+        if (sensirion_common_generate_crc(word, 2) != word[2]) {
+            return 1;
+        }
+        words[i] = static_cast<uint16_t>(word[0] << 8 | word[1]);
+    }
+    return 0;
+}
+} // namespace
+
+extern "C" {
+uint8_t sensirion_common_generate_crc(const uint8_t* data, uint16_t count)
+{
+    uint8_t crc = 0xFF;
+    for (uint16_t i = 0; i < count; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+int16_t scd4x_start_periodic_measurement(void)
+{
+    return command(0x21B1, 0);
+}
+
+int16_t scd4x_start_low_power_periodic_measurement(void)
+{
+    return command(0x21AC, 0);
+}
+
+int16_t scd4x_stop_periodic_measurement(void)
+{
+    return command(0x3F86, 500);
+}
+
+int16_t scd4x_get_serial_number(uint16_t* serial_0, uint16_t* serial_1, uint16_t* serial_2)
+{
+    auto error = command(0x3682, 1);
+    std::array<uint16_t, 3> words = {};
+    if (!error) {
+        error = read(words.data(), words.size());
+    }
+    *serial_0 = words[0];
+    *serial_1 = words[1];
+    *serial_2 = words[2];
+    return error;
+}
+
+int16_t scd4x_reinit(void)
+{
+    return command(0x3646, 20);
+}
+
+int16_t scd4x_power_down(void)
+{
+    return command(0x36E0, 1);
+}
+
+// The sensor does not acknowledge the wake up command, like the driver this ignores the error
+int16_t scd4x_wake_up(void)
+{
+    command(0x36F6, 0);
+    sensirion_i2c_hal_sleep_usec(20000);
+    return 0;
+}
+}
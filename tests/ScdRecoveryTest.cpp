@@ -0,0 +1,108 @@
+#include "I2CBus.h"
+#include "SCD.h"
+
+#include <pico/time.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+using namespace weather_station;
+
+namespace
+{
+constexpr uint64_t second = 1000;
+constexpr uint64_t pollInterval = second;
+// One round of the emulator's fault script, see ScdEmulator.cpp
+constexpr uint64_t scriptPeriod = 600 * second;
+constexpr uint64_t sampleInterval = 5 * second;
+
+struct Step
+{
+    const char* name;
+    uint64_t at;
+    // Polls from the fault to the next good sample, including the sample interval the sensor needs after a restart
+    uint64_t maxPolls;
+};
+
+constexpr Step steps[] = {
+    // The poll that sees the first of two NACKs restarts the sensor, which waits 5 s before polling again
+    {"nack", 120 * second, 14},
+    // 20 data ready polls answered "not ready" while a sample waits
+    {"stuck not ready", 240 * second, 27},
+    // Two samples with zero CO2, 5 s apart
+    {"zero co2", 360 * second, 3 * sampleInterval / pollInterval + 1},
+    // One corrupted response, a later poll reads the sample
+    {"bad crc", 480 * second, sampleInterval / pollInterval + 2},
+};
+
+bool failed = false;
+
+void expect(bool condition, const char* what)
+{
+    if (!condition) {
+        std::cout << "FAILED: " << what << "\n";
+        failed = true;
+    }
+}
+
+struct Sample
+{
+    uint64_t time;
+    uint16_t co2;
+};
+} // namespace
+
+// The SCD driver against the emulated sensor behind the I2C bus for two rounds of the fault script. After every fault
+// the driver has to deliver a good sample again within the polls the fault costs, and in between a sample every 5 s.
+int main()
+{
+    fake_sdk::timeUs = 1000000;
+    auto boot = time_us_64() / 1000;
+    SCD scd(0);
+
+    std::vector<Sample> samples;
+    for (auto end = boot + 2 * scriptPeriod + 60 * second; time_us_64() / 1000 < end;) {
+        fake_sdk::timeUs += 1000;
+        I2CBus::processAll();
+        if (scd.process()) {
+            samples.push_back({time_us_64() / 1000, scd.GetMeasurement().CO2});
+        }
+    }
+    scd.printStats();
+    I2CBus::printAllStats();
+
+    std::vector<uint64_t> good;
+    for (const auto& sample : samples) {
+        if (sample.co2 != 0) {
+            good.push_back(sample.time);
+        }
+    }
+    auto zeros = samples.size() - good.size();
+    std::cout << samples.size() << " samples, " << zeros << " with zero CO2\n";
+    expect(zeros == 4, "two zero CO2 samples per round");
+
+    // Longest time without a good sample that ends within [from, to)
+    auto longestGap = [&](uint64_t from, uint64_t to) {
+        uint64_t longest = 0;
+        for (size_t i = 1; i < good.size(); ++i) {
+            if (good[i] >= from && good[i] < to) {
+                longest = std::max(longest, good[i] - good[i - 1]);
+            }
+        }
+        return longest;
+    };
+    for (uint64_t round = 0; round < 2; ++round) {
+        auto start = boot + round * scriptPeriod;
+        for (const auto& step : steps) {
+            auto at = start + step.at;
+            auto gap = longestGap(at, at + 60 * second);
+            std::cout << "round " << round << ", " << step.name << ": " << gap / pollInterval << " polls without a sample\n";
+            expect(gap <= step.maxPolls * pollInterval, step.name);
+            // Back to a sample every 5 s before the next fault
+            expect(longestGap(at + 60 * second, at + 120 * second) <= sampleInterval + pollInterval, "steady after");
+        }
+    }
+    return failed ? 1 : 0;
+}
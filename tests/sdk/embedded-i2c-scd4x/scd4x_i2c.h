@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in for the Sensirion SCD4x driver, the commands SCD.cpp uses. Implemented in tests/Scd4xDriver.cpp on
+// top of the HAL with the command codes and execution times of the datasheet.
+
+#include <cstdint>
+
+extern "C" {
+int16_t scd4x_start_periodic_measurement(void);
+int16_t scd4x_start_low_power_periodic_measurement(void);
+int16_t scd4x_stop_periodic_measurement(void);
+int16_t scd4x_get_serial_number(uint16_t* serial_0, uint16_t* serial_1, uint16_t* serial_2);
+int16_t scd4x_reinit(void);
+int16_t scd4x_power_down(void);
+int16_t scd4x_wake_up(void);
+}
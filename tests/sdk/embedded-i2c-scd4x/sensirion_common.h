@@ -0,0 +1,9 @@
+#pragma once
+
+// Host stand-in for the Sensirion driver's common definitions, implemented in tests/Scd4xDriver.cpp
+
+#include <cstdint>
+
+extern "C" {
+uint8_t sensirion_common_generate_crc(const uint8_t* data, uint16_t count);
+}
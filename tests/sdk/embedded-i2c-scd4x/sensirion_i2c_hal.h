@@ -0,0 +1,14 @@
+#pragma once
+
+// The Sensirion driver's bus HAL, implemented by the firmware in SensirionHal.cpp
+
+#include <cstdint>
+
+extern "C" {
+int16_t sensirion_i2c_hal_select_bus(uint8_t bus_idx);
+void sensirion_i2c_hal_init(void);
+void sensirion_i2c_hal_free(void);
+int8_t sensirion_i2c_hal_read(uint8_t address, uint8_t* data, uint16_t count);
+int8_t sensirion_i2c_hal_write(uint8_t address, const uint8_t* data, uint16_t count);
+void sensirion_i2c_hal_sleep_usec(uint32_t useconds);
+}
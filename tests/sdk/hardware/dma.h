@@ -0,0 +1,3 @@
+#pragma once
+
+// Host stand-in, with the SCD emulator in place of the I2C controller there are no DMA transfers
@@ -0,0 +1,36 @@
+#pragma once
+
+// Host stand-in for the pico-sdk flash API: the flash is a buffer that programming can only clear bits in
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (64 * FLASH_SECTOR_SIZE)
+
+namespace fake_sdk
+{
+inline std::vector<uint8_t> flash(PICO_FLASH_SIZE_BYTES, 0xFF);
+inline uint32_t pagesProgrammed = 0;
+inline uint32_t sectorsErased = 0;
+} // namespace fake_sdk
+
+#define XIP_BASE reinterpret_cast<uintptr_t>(fake_sdk::flash.data())
+
+inline void flash_range_program(uint32_t offset, const uint8_t* data, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        fake_sdk::flash.at(offset + i) &= data[i];
+    }
+    fake_sdk::pagesProgrammed += count / FLASH_PAGE_SIZE;
+}
+
+inline void flash_range_erase(uint32_t offset, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        fake_sdk::flash.at(offset + i) = 0xFF;
+    }
+    fake_sdk::sectorsErased += count / FLASH_SECTOR_SIZE;
+}
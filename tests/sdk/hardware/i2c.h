@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in for the pico-sdk I2C instances, with the SCD emulator in place of the controller nothing else is used
+
+typedef struct i2c_inst
+{
+    unsigned index;
+} i2c_inst_t;
+
+namespace fake_sdk
+{
+inline i2c_inst_t i2c[2] = {{0}, {1}};
+} // namespace fake_sdk
+
+#define i2c0 (&fake_sdk::i2c[0])
+#define i2c1 (&fake_sdk::i2c[1])
@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in for pico-sdk's hardware/sync.h: a test thread plays core 1 by setting its core number
+
+namespace fake_sdk
+{
+inline thread_local unsigned core = 0;
+} // namespace fake_sdk
+
+inline unsigned get_core_num()
+{
+    return fake_sdk::core;
+}
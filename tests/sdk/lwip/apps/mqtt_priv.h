@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in for the lwIP MQTT client state, only the connection is visible to the firmware
+
+#include "lwip/apps/mqtt.h"
+
+struct altcp_pcb;
+
+struct mqtt_client_s
+{
+    // Set while connected to the broker stub
+    altcp_pcb* conn;
+};
+
+// Drops the connection like a reset from the network, the client reports MQTT_CONNECT_DISCONNECTED
+void altcp_abort(altcp_pcb* conn);
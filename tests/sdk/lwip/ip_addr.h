@@ -0,0 +1,24 @@
+#pragma once
+
+// Host stand-in for lwIP addresses, IPv4 only
+
+#include "lwip/err.h"
+
+#include <cstdio>
+
+typedef struct ip_addr
+{
+    u32_t addr;
+} ip_addr_t;
+
+#define IPADDR_TYPE_ANY 46U
+#define IP_ANY_TYPE (static_cast<const ip_addr_t*>(nullptr))
+
+// Network byte order like lwIP, so the first octet is the lowest byte
+inline char* ipaddr_ntoa(const ip_addr_t* addr)
+{
+    static char text[16];
+    auto a = addr->addr;
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", a & 0xFF, (a >> 8) & 0xFF, (a >> 16) & 0xFF, a >> 24);
+    return text;
+}
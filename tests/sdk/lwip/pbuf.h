@@ -0,0 +1,48 @@
+#pragma once
+
+// Host stand-in for lwIP packet buffers: always a single buffer, there are no pools to run out of
+
+#include "lwip/err.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+typedef enum { PBUF_TRANSPORT, PBUF_IP, PBUF_LINK, PBUF_RAW } pbuf_layer;
+typedef enum { PBUF_RAM, PBUF_ROM, PBUF_REF, PBUF_POOL } pbuf_type;
+
+struct pbuf
+{
+    pbuf* next = nullptr;
+    void* payload = nullptr;
+    u16_t tot_len = 0;
+    u16_t len = 0;
+    std::vector<u8_t> storage;
+};
+
+inline pbuf* pbuf_alloc(pbuf_layer, u16_t length, pbuf_type type)
+{
+    auto p = new pbuf;
+    p->tot_len = p->len = length;
+    if (type != PBUF_REF && type != PBUF_ROM) {
+        p->storage.resize(length);
+        p->payload = p->storage.data();
+    }
+    return p;
+}
+
+inline u8_t pbuf_free(pbuf* p)
+{
+    delete p;
+    return 1;
+}
+
+inline u16_t pbuf_copy_partial(const pbuf* p, void* data, u16_t length, u16_t offset)
+{
+    if (offset >= p->len) {
+        return 0;
+    }
+    u16_t copied = std::min<u16_t>(length, p->len - offset);
+    memcpy(data, static_cast<const u8_t*>(p->payload) + offset, copied);
+    return copied;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stand-in, the MQTT client stub does not go through TCP
+
+#include "lwip/err.h"
@@ -0,0 +1,56 @@
+#pragma once
+
+// Host stand-in for the lwIP timeouts, run by the test on the fake clock
+
+#include "lwip/err.h"
+#include "pico/time.h"
+
+#include <algorithm>
+#include <vector>
+
+typedef void (*sys_timeout_handler)(void* arg);
+
+namespace fake_sdk
+{
+struct Timeout
+{
+    uint64_t dueMs;
+    sys_timeout_handler handler;
+    void* arg;
+};
+
+inline std::vector<Timeout> timeouts;
+
+// Runs the timeouts due at time_us_64() in order, including the ones they add that are due already
+inline void runTimeouts()
+{
+    for (;;) {
+        auto due = std::min_element(timeouts.begin(), timeouts.end(), [](const Timeout& a, const Timeout& b) {
+            return a.dueMs < b.dueMs;
+        });
+        if (due == timeouts.end() || due->dueMs > time_us_64() / 1000) {
+            return;
+        }
+        auto timeout = *due;
+        timeouts.erase(due);
+        timeout.handler(timeout.arg);
+    }
+}
+} // namespace fake_sdk
+
+inline void sys_timeout(u32_t ms, sys_timeout_handler handler, void* arg)
+{
+    fake_sdk::timeouts.push_back({time_us_64() / 1000 + ms, handler, arg});
+}
+
+// Removes the first match, like lwIP
+inline void sys_untimeout(sys_timeout_handler handler, void* arg)
+{
+    auto& timeouts = fake_sdk::timeouts;
+    auto match = std::find_if(timeouts.begin(), timeouts.end(), [&](const fake_sdk::Timeout& t) {
+        return t.handler == handler && t.arg == arg;
+    });
+    if (match != timeouts.end()) {
+        timeouts.erase(match);
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// Host stand-in for the lwIP UDP API. Sent datagrams are collected, the test hands received ones to the pcb bound to
+// their port.
+
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+#include <algorithm>
+#include <vector>
+
+struct udp_pcb;
+typedef void (*udp_recv_fn)(void* arg, udp_pcb* pcb, pbuf* p, const ip_addr_t* addr, u16_t port);
+
+struct udp_pcb
+{
+    u16_t port = 0;
+    udp_recv_fn recv = nullptr;
+    void* arg = nullptr;
+};
+
+namespace fake_sdk
+{
+struct Datagram
+{
+    u16_t port;
+    std::vector<u8_t> data;
+};
+
+inline std::vector<udp_pcb*> udpPcbs;
+inline std::vector<Datagram> udpSent;
+
+// A datagram from the LAN, false if nothing receives on port
+inline bool udpReceive(u16_t port, const void* data, u16_t size)
+{
+    auto pcb = std::find_if(udpPcbs.begin(), udpPcbs.end(), [&](udp_pcb* p) { return p->port == port && p->recv; });
+    if (pcb == udpPcbs.end()) {
+        return false;
+    }
+    auto p = pbuf_alloc(PBUF_TRANSPORT, size, PBUF_RAM);
+    memcpy(p->payload, data, size);
+    ip_addr_t from{0x0201A8C0};
+    (*pcb)->recv((*pcb)->arg, *pcb, p, &from, 5555);
+    return true;
+}
+} // namespace fake_sdk
+
+inline udp_pcb* udp_new_ip_type(u8_t)
+{
+    auto pcb = new udp_pcb;
+    fake_sdk::udpPcbs.push_back(pcb);
+    return pcb;
+}
+
+inline void udp_remove(udp_pcb* pcb)
+{
+    fake_sdk::udpPcbs.erase(std::remove(fake_sdk::udpPcbs.begin(), fake_sdk::udpPcbs.end(), pcb), fake_sdk::udpPcbs.end());
+    delete pcb;
+}
+
+inline err_t udp_bind(udp_pcb* pcb, const ip_addr_t*, u16_t port)
+{
+    pcb->port = port;
+    return ERR_OK;
+}
+
+inline void udp_recv(udp_pcb* pcb, udp_recv_fn recv, void* arg)
+{
+    pcb->recv = recv;
+    pcb->arg = arg;
+}
+
+inline err_t udp_sendto(udp_pcb*, pbuf* p, const ip_addr_t*, u16_t port)
+{
+    auto data = static_cast<const u8_t*>(p->payload);
+    fake_sdk::udpSent.push_back({port, std::vector<u8_t>(data, data + p->len)});
+    return ERR_OK;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Host stand-in: no lwIP thread or interrupts, the test runs everything on its own thread
+
+inline void cyw43_arch_lwip_begin() {}
+inline void cyw43_arch_lwip_end() {}
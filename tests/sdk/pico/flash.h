@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in for the pico-sdk: there is no other core or XIP to protect, the operation just runs
+
+#include <cstdint>
+
+#define PICO_OK 0
+
+inline int flash_safe_execute(void (*func)(void*), void* param, uint32_t)
+{
+    func(param);
+    return PICO_OK;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Host stand-in for the parts of the pico-sdk stdlib that the firmware under test uses. Sleeping moves the fake
+// clock on.
+
+#include "pico/time.h"
+
+#include <cstdint>
+#include <cstdio>
+
+#define GPIO_OUT 1
+
+inline void gpio_init(uint32_t) {}
+inline void gpio_set_dir(uint32_t, bool) {}
+inline void gpio_put(uint32_t, bool) {}
+
+inline void sleep_us(uint64_t us)
+{
+    fake_sdk::timeUs += us;
+}
+
+inline void sleep_ms(uint32_t ms)
+{
+    sleep_us(ms * 1000ULL);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// Host stand-in for the pico-sdk timer, the test sets the time
+
+#include <cstdint>
+
+namespace fake_sdk
+{
+inline uint64_t timeUs = 0;
+} // namespace fake_sdk
+
+inline uint64_t time_us_64()
+{
+    return fake_sdk::timeUs;
+}
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Converts a trace dump of a -DTRACE=1 build into Chrome trace JSON, which ui.perfetto.dev opens directly.
+
+Capture the dump from the USB console, e.g.
+
+    (printf t; sleep 2) > /dev/ttyACM0 & cat /dev/ttyACM0 > capture.bin
+    tools/trace_to_perfetto.py capture.bin trace.json
+
+Console text around the dump is skipped. FIFO pushes on core 0 are matched to the pops on core 1 and drawn as flow
+arrows, the handoff latency and the longest gaps between display refreshes are printed.
+"""
+
+import json
+import struct
+import sys
+
+MAGIC = b"WSTRACE1"
+EVENT = struct.Struct("<QIBBBB")
+BEGIN, END, INSTANT = 0, 1, 2
+
+
+def parse(data):
+    start = data.rfind(MAGIC)
+    if start < 0:
+        raise SystemExit("no trace dump found")
+    pos = start + len(MAGIC)
+    (name_count,) = struct.unpack_from("<I", data, pos)
+    pos += 4
+    names = []
+    for _ in range(name_count):
+        end = data.index(b"\0", pos)
+        names.append(data[pos:end].decode())
+        pos = end + 1
+    (event_count,) = struct.unpack_from("<I", data, pos)
+    pos += 4
+    events = []
+    for _ in range(event_count):
+        if pos + EVENT.size > len(data):
+            print("dump truncated after %d events" % len(events), file=sys.stderr)
+            break
+        time, arg, point, kind, core, _ = EVENT.unpack_from(data, pos)
+        pos += EVENT.size
+        events.append({"time": time, "arg": arg, "name": names[point], "kind": kind, "core": core})
+    events.sort(key=lambda e: e["time"])
+    return events
+
+
+def match_fifo(events):
+    """Pairs every pop with the oldest unmatched push of the same word, the FIFO keeps them in order."""
+    pending = []
+    pairs = []
+    for event in events:
+        if event["name"] == "fifo push":
+            pending.append(event)
+        elif event["name"] == "fifo pop":
+            for i, push in enumerate(pending):
+                if push["arg"] == event["arg"]:
+                    pairs.append((push, event))
+                    del pending[i]
+                    break
+    return pairs
+
+
+def convert(events, pairs):
+    phase = {BEGIN: "B", END: "E", INSTANT: "i"}
+    trace = []
+    for event in events:
+        entry = {"name": event["name"], "ph": phase[event["kind"]], "ts": event["time"], "pid": 1, "tid": event["core"]}
+        if event["kind"] == INSTANT:
+            entry["s"] = "t"
+        if event["kind"] != END:
+            entry["args"] = {"arg": event["arg"]}
+        trace.append(entry)
+    for flow, (push, pop) in enumerate(pairs):
+        trace.append({"name": "handoff", "cat": "fifo", "ph": "s", "id": flow, "ts": push["time"], "pid": 1, "tid": 0})
+        trace.append({"name": "handoff", "cat": "fifo", "ph": "f", "bp": "e", "id": flow, "ts": pop["time"], "pid": 1,
+                      "tid": 1})
+    for core in (0, 1):
+        trace.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": core, "args": {"name": "core %d" % core}})
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}
+
+
+def report(events, pairs):
+    if pairs:
+        latencies = sorted(pop["time"] - push["time"] for push, pop in pairs)
+        print("FIFO handoff: %d words, latency min %d us, median %d us, max %d us" % (
+            len(latencies), latencies[0], latencies[len(latencies) // 2], latencies[-1]))
+    refreshes = [e["time"] for e in events if e["name"] == "refreshDisplay" and e["kind"] == BEGIN]
+    gaps = sorted(((b - a, a) for a, b in zip(refreshes, refreshes[1:])), reverse=True)[:5]
+    for gap, at in gaps:
+        print("Display stall: %d us without a refresh at %d us" % (gap, at))
+
+
+def main():
+    if len(sys.argv) != 3:
+        raise SystemExit("usage: %s capture.bin trace.json" % sys.argv[0])
+    with open(sys.argv[1], "rb") as f:
+        events = parse(f.read())
+    pairs = match_fifo(events)
+    with open(sys.argv[2], "w") as f:
+        json.dump(convert(events, pairs), f)
+    print("%d events written to %s" % (len(events), sys.argv[2]))
+    report(events, pairs)
+
+
+if __name__ == "__main__":
+    main()
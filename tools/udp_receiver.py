@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Receives the datagrams of a -DUDP_SERVER build and prints one reading per line, whatever UDP_FORMAT it was built
+with: StatsD gauges, InfluxDB line protocol or the binary PeerReading of PeerReading.h that peers send to a gateway.
+
+    tools/udp_receiver.py [port]
+
+The port defaults to 8125. Every datagram is decoded on its own, so stations with different formats can share the
+port. On Ctrl-C the datagrams and bytes per station are printed, for Compact also the readings lost by sequence gaps,
+to set against the UDP line of the station's export stats.
+"""
+
+import datetime
+import socket
+import struct
+import sys
+
+# PeerReading: header, version, reserved, station, sequence, stamp, co2, temperature, humidity, padding
+PEER_READING = struct.Struct("<HBB12sIIHhHH")
+PEER_MAGIC = 0x5357
+PEER_VERSION = 1
+
+
+def decode_compact(data):
+    header, version, _, station, sequence, stamp, co2, temperature, humidity, _ = PEER_READING.unpack(data)
+    if header != PEER_MAGIC or version != PEER_VERSION:
+        raise ValueError("not a PeerReading version %d" % PEER_VERSION)
+    return {"format": "compact", "station": station.split(b"\0")[0].decode(), "sequence": sequence,
+            "stamp": stamp or None, "co2": co2, "temperature": temperature / 100, "humidity": humidity / 100}
+
+
+def decode_statsd(text):
+    """weather.<station>.<metric>:<value>|g, one gauge per line."""
+    reading = {"format": "statsd"}
+    for line in text.splitlines():
+        name, value = line.rsplit("|", 1)[0].rsplit(":", 1)
+        _, station, metric = name.split(".", 2)
+        reading["station"] = station
+        reading[metric] = float(value)
+    return reading
+
+
+def decode_influx(text):
+    """weather,station=<station> co2=<n>i,temperature=<t>,humidity=<h>[ <ns>]"""
+    parts = text.split(" ")
+    tags = dict(tag.split("=", 1) for tag in parts[0].split(",")[1:])
+    reading = {"format": "influx", "station": tags.get("station")}
+    for field in parts[1].split(","):
+        key, value = field.split("=", 1)
+        reading[key] = float(value.rstrip("i"))
+    if len(parts) > 2:
+        reading["stamp"] = int(parts[2]) // 1000000000
+    return reading
+
+
+def decode(data):
+    if len(data) == PEER_READING.size and struct.unpack_from("<H", data)[0] == PEER_MAGIC:
+        return decode_compact(data)
+    text = data.decode()
+    if "|g" in text:
+        return decode_statsd(text)
+    return decode_influx(text)
+
+
+def describe(reading):
+    fields = []
+    for key, unit in (("co2", "ppm"), ("temperature", "C"), ("humidity", "%")):
+        if key in reading:
+            fields.append("%s %g %s" % (key, reading[key], unit))
+    if "sequence" in reading:
+        fields.append("seq %d" % reading["sequence"])
+    if reading.get("stamp"):
+        fields.append("taken %s" % datetime.datetime.fromtimestamp(reading["stamp"], datetime.timezone.utc)
+                      .strftime("%H:%M:%S"))
+    return "%-8s %-14s %s" % (reading["format"], reading.get("station"), ", ".join(fields))
+
+
+class Station:
+    def __init__(self):
+        self.datagrams = 0
+        self.bytes = 0
+        self.lost = 0
+        self.last_sequence = None
+
+    def add(self, reading, size):
+        self.datagrams += 1
+        self.bytes += size
+        sequence = reading.get("sequence")
+        if sequence is None:
+            return
+        # The flash log numbers every reading, a gap is a lost datagram. A smaller number is a restart with a fresh log.
+        if self.last_sequence is not None and sequence > self.last_sequence:
+            self.lost += sequence - self.last_sequence - 1
+        self.last_sequence = sequence
+
+
+def report(stations, malformed):
+    for name, station in sorted(stations.items()):
+        line = "%s: %d datagrams, %d bytes/datagram" % (name, station.datagrams, station.bytes // station.datagrams)
+        if station.last_sequence is not None:
+            line += ", %d lost" % station.lost
+        print(line)
+    if malformed:
+        print("%d malformed datagrams" % malformed)
+
+
+def main():
+    if len(sys.argv) > 2:
+        raise SystemExit("usage: %s [port]" % sys.argv[0])
+    port = int(sys.argv[1]) if len(sys.argv) == 2 else 8125
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", port))
+    print("Listening on UDP port %d" % port)
+    stations = {}
+    malformed = 0
+    try:
+        while True:
+            data, (host, _) = sock.recvfrom(2048)
+            now = datetime.datetime.now().strftime("%H:%M:%S")
+            try:
+                reading = decode(data)
+            except (ValueError, IndexError, UnicodeDecodeError, struct.error) as error:
+                malformed += 1
+                print("%s %-15s malformed %d bytes: %s" % (now, host, len(data), error))
+                continue
+            stations.setdefault(reading.get("station") or host, Station()).add(reading, len(data))
+            print("%s %-15s %s" % (now, host, describe(reading)))
+    except KeyboardInterrupt:
+        print()
+    report(stations, malformed)
+
+
+if __name__ == "__main__":
+    main()